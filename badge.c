@@ -3,8 +3,6 @@
  *
  * Code for a furry PCB badge built around the tiny45 and WS2812 LEDs
  */
-#define F_CPU 8000000UL
-
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -13,11 +11,18 @@
 #include <avr/interrupt.h>
 #include <avr/io.h>
 #include <avr/pgmspace.h>
+#include <avr/sleep.h>
+#include <avr/wdt.h>
 #include <util/delay.h>
 
 #include "rgb.h"
 #include "hsv2rgb.h"
 #include "led_bitbang.h"
+#include "battery.h"
+#include "boop.h"
+#include "noise.h"
+#include "palette.h"
+#include "stack.h"
 
 #define LEFT 0
 #define LEFT_G 0
@@ -38,59 +43,28 @@
 #define BIT_6 0x40
 #define BIT_7 0x80
 
-#define MODE_COUNT 8
+/* Go to standby after this long without a boop */
+#define STANDBY_TIMEOUT_TICKS (10 * 60 * 50) /* Ten minutes */
+
+/* Readings taken on entering standby, for the booper's level when untouched */
+#define STANDBY_BASELINE_SAMPLES 4
+
+/* Take a new boop baseline when the supply reading moves this far */
+#define BATTERY_REBASELINE_DELTA 8
+
+/* Repeat the low battery warning every this many readings */
+#define BATTERY_WARN_READINGS 6 /* One minute */
 
 /*
  * State
  */
 static uint8_t mode  = 0;
 static uint8_t frame = 0;
-static uint8_t boop  = 0;
+static uint16_t ticks = 0;
+static uint8_t brightness = 0xff; /* Master brightness, applied by led_show_scaled */
+static uint16_t idle_ticks = 0;
+static volatile bool standby_request = false;
 static uint8_t pixels[6] = {0, 0, 0, 0, 0, 0};
-static uint16_t boop_baseline = 0;
-
-/*
- * Read the boop sensor, subtracting the baseline if one has been set.
- */
-uint16_t boop_sense (void)
-{
-    uint16_t fall_time = 0;
-
-    /* Set the driven pin high */
-    PORTB |= (1 << 1);
-    _delay_ms (10);
-
-    /* Set the driven pin low */
-    PORTB &= ~(1 << 1);
-
-    /* Time the falling edge, in loops */
-    while (PINB & 0x01)
-    {
-        fall_time++;
-    }
-
-    if (fall_time < boop_baseline)
-    {
-        fall_time = boop_baseline;
-    }
-
-    return fall_time - boop_baseline;
-}
-
-/*
- * Get a baseline non-boop reading to subtract from future readings.
- */
-void boop_calibrate (void)
-{
-    uint16_t boop_sum = 0;
-    for (int i = 0; i < 10; i++)
-    {
-        boop_sum += boop_sense ();
-        _delay_ms (50);
-    }
-
-    boop_baseline = boop_sum / 10;
-}
 
 typedef enum Volume_e {
     VOLUME_OFF,
@@ -103,9 +77,12 @@ typedef enum Volume_e {
  */
 void sound_set (uint16_t freq, Volume_t volume)
 {
-
-    OCR1C = 31250 / freq - 1; /* Count to */
-    OCR1B = OCR1C / 2; /* 50% duty cycle */
+    /* Rests have no frequency to set */
+    if (freq)
+    {
+        OCR1C = 31250 / freq - 1; /* Count to */
+        OCR1B = OCR1C / 2; /* 50% duty cycle */
+    }
 
     switch (volume)
     {
@@ -127,58 +104,149 @@ void sound_set (uint16_t freq, Volume_t volume)
     }
 }
 
-typedef struct Sound_s
+/*
+ * Update the LED pattern for the current state.
+ */
+#define CYCLE_192_FRAMES    frame = (frame % 0xc0)
+#define CYCLE_256_FRAMES
+
+typedef enum Eye_e {
+    EYE_LEFT,
+    EYE_RIGHT,
+    EYE_BOTH
+} Eye_t;
+
+void eye_hsv_set (uint8_t hue, uint8_t sat, uint8_t val, Eye_t eye)
 {
-    uint16_t freq;
-    uint16_t duration_ms;
-    uint8_t volume;
-    int8_t freq_shift;
-} Sound_t;
-
-const Sound_t sound_mode_change [] PROGMEM = {
-    { 440, 100, VOLUME_SOFT, 0 },
-    {   0, 100, VOLUME_OFF,  0 },
-    { 880, 100, VOLUME_SOFT, 0 },
-    { }
+    RGB_t rgb;
+
+    hsv2rgb_rainbow (hue, sat, val, &rgb);
+
+    switch (eye)
+    {
+        case EYE_LEFT:
+            memcpy (&pixels [LEFT],  &rgb, 3);
+            break;
+        case EYE_RIGHT:
+            memcpy (&pixels [RIGHT], &rgb, 3);
+            break;
+        case EYE_BOTH:
+            memcpy (&pixels [LEFT],  &rgb, 3);
+            memcpy (&pixels [RIGHT], &rgb, 3);
+        default:
+            break;
+    }
+}
+
+uint8_t triangle (uint8_t range, uint8_t period, uint8_t frame)
+{
+    uint16_t half_period = period >> 1;
+
+    return abs ((frame % period) - half_period) * range / half_period;
+}
+
+/*
+ * Timeline sequencer.
+ *
+ * A clip has a light track and a sound track, each a list of cues in
+ * PROGMEM, and both are driven from one clock. The clock counts in
+ * milliseconds but only advances in 20 ms steps, once per tick. Cues are
+ * authored in milliseconds and take effect on the first tick at or after
+ * their time, so their times are rounded up to a multiple of 20 ms.
+ */
+#define TIMELINE_TICK_MS 20
+
+typedef enum CueType_e {
+    CUE_END,
+    CUE_LIGHT,
+    CUE_TONE
+} CueType_t;
+
+/* Strobe: lit while (frame & mask) is zero, or non-zero if inverted */
+#define STROBE_MASK     0x3f
+#define STROBE_RANDOM   0x40 /* Lit at random instead */
+#define STROBE_INVERT   0x80
+
+typedef struct Cue_s
+{
+    uint16_t time_ms;   /* From the start of the clip */
+    uint8_t type;
+    uint8_t level;      /* Light: val, Tone: volume */
+    int8_t shift;       /* Change per tick, Light: of hue, Tone: of frequency */
+    union {
+        struct {
+            uint8_t eye;
+            uint8_t hue;    /* Added to the clip's base hue */
+            uint8_t strobe;
+            uint8_t jitter; /* Mask for a random addition to the hue */
+        } light;
+        uint16_t freq;
+    };
+} Cue_t;
+
+#define LIGHT(ms, eye, hue, val, strobe, shift, jitter) \
+    { (ms), CUE_LIGHT, (val), (shift), .light = { (eye), (hue), (strobe), (jitter) } }
+#define TONE(ms, hz, volume, shift) \
+    { (ms), CUE_TONE, (volume), (shift), .freq = (hz) }
+#define END(ms) \
+    { (ms), CUE_END, 0, 0, .freq = 0 }
+
+/*
+ * Sound tracks
+ */
+const Cue_t sound_mode_change [] PROGMEM = {
+    TONE (  0, 440, VOLUME_SOFT, 0),
+    TONE (100,   0, VOLUME_OFF,  0),
+    TONE (200, 880, VOLUME_SOFT, 0),
+    END  (300)
+};
+
+const Cue_t sound_low_battery [] PROGMEM = {
+    TONE (  0, 880, VOLUME_SOFT,  0),
+    TONE (150,   0, VOLUME_OFF,   0),
+    TONE (200, 660, VOLUME_SOFT,  0),
+    TONE (350,   0, VOLUME_OFF,   0),
+    TONE (400, 440, VOLUME_SOFT, -5),
+    END  (800)
 };
 
-const Sound_t sound_boop_siren [] PROGMEM = {
-    { 1500, 800, VOLUME_LOUD, -25 },
-    {  500, 800, VOLUME_LOUD,  25 },
-    { 1500, 800, VOLUME_LOUD, -25 },
-    {  500, 800, VOLUME_LOUD,  25 },
-    { 1500, 800, VOLUME_LOUD, -25 },
-    { }
+const Cue_t sound_boop_siren [] PROGMEM = {
+    TONE (   0, 1500, VOLUME_LOUD, -25),
+    TONE ( 800,  500, VOLUME_LOUD,  25),
+    TONE (1600, 1500, VOLUME_LOUD, -25),
+    TONE (2400,  500, VOLUME_LOUD,  25),
+    TONE (3200, 1500, VOLUME_LOUD, -25),
+    END  (4000)
 };
 
 #define BOOP_COUNT 3
 
-const Sound_t sound_boop_0 [] PROGMEM = {
-    { 440, 300,  VOLUME_LOUD,  100 },
-    { 1940, 100, VOLUME_LOUD, -100 },
-    { }
+const Cue_t sound_boop_0 [] PROGMEM = {
+    TONE (  0,  440, VOLUME_LOUD,  100),
+    TONE (300, 1940, VOLUME_LOUD, -100),
+    END  (400)
 };
 
-const Sound_t sound_boop_1 [] PROGMEM = {
-    { 440, 200, VOLUME_LOUD, 100 },
-    {   0,  20, VOLUME_OFF,  0 },
-    { 440, 200, VOLUME_LOUD, 100 },
-    { }
+const Cue_t sound_boop_1 [] PROGMEM = {
+    TONE (  0, 440, VOLUME_LOUD, 100),
+    TONE (200,   0, VOLUME_OFF,  0),
+    TONE (220, 440, VOLUME_LOUD, 100),
+    END  (420)
 };
 
-const Sound_t sound_boop_2 [] PROGMEM = {
-    { 440,  60, VOLUME_LOUD, 0 },
-    {   0,  40, VOLUME_OFF,  0 },
-    { 440,  60, VOLUME_LOUD, 0 },
-    {   0,  40, VOLUME_OFF,  0 },
-    { 440, 200, VOLUME_LOUD, 100 },
-    { }
+const Cue_t sound_boop_2 [] PROGMEM = {
+    TONE (  0, 440, VOLUME_LOUD, 0),
+    TONE ( 60,   0, VOLUME_OFF,  0),
+    TONE (100, 440, VOLUME_LOUD, 0),
+    TONE (160,   0, VOLUME_OFF,  0),
+    TONE (200, 440, VOLUME_LOUD, 100),
+    END  (400)
 };
 
-const Sound_t *get_next_boop_sound (void)
+const Cue_t *get_next_boop_sound (void)
 {
     static uint8_t sound_index = 0;
-    const Sound_t *sound = NULL;
+    const Cue_t *sound = NULL;
 
     switch (sound_index)
     {
@@ -198,322 +266,357 @@ const Sound_t *get_next_boop_sound (void)
     return sound;
 }
 
-const Sound_t *play_sound = NULL;
+/*
+ * Light tracks
+ */
+const Cue_t lights_low_battery [] PROGMEM = {
+    LIGHT (   0, EYE_BOTH, HUE_RED, 0x10, 0x08, 0, 0),
+    END   (1920)
+};
+
+/* Pink and violet, flickering */
+const Cue_t lights_boop_flicker [] PROGMEM = {
+    LIGHT (  0, EYE_BOTH, HUE_PINK,   0x18, STROBE_INVERT | 0x02, 0, 0),
+    LIGHT ( 80, EYE_BOTH, HUE_VIOLET, 0x18, STROBE_INVERT | 0x02, 0, 0),
+    LIGHT (160, EYE_BOTH, HUE_PINK,   0x18, STROBE_INVERT | 0x02, 0, 0),
+    LIGHT (240, EYE_BOTH, HUE_VIOLET, 0x18, STROBE_INVERT | 0x02, 0, 0),
+    LIGHT (320, EYE_BOTH, HUE_PINK,   0x18, STROBE_INVERT | 0x02, 0, 0),
+    LIGHT (400, EYE_BOTH, HUE_VIOLET, 0x18, STROBE_INVERT | 0x02, 0, 0),
+    LIGHT (480, EYE_BOTH, HUE_PINK,   0x18, STROBE_INVERT | 0x02, 0, 0),
+    LIGHT (560, EYE_BOTH, HUE_VIOLET, 0x18, STROBE_INVERT | 0x02, 0, 0),
+    END   (640)
+};
+
+/* Left and right taking turns, in the clip's hue */
+const Cue_t lights_boop_strobe [] PROGMEM = {
+    LIGHT (  0, EYE_LEFT,  0, 0x18, 0x04, 0, 0),
+    LIGHT (  0, EYE_RIGHT, 0, 0x18, STROBE_INVERT | 0x04, 0, 0),
+    END   (640)
+};
+
+/* Bright, fast, and crazy */
+const Cue_t lights_boop_rainbow [] PROGMEM = {
+    LIGHT (   0, EYE_LEFT,   64, 0x18, 0, 4, 0),
+    LIGHT (   0, EYE_RIGHT, 192, 0x18, 0, 4, 0),
+    END   (2560)
+};
+
+/* Red and blue, swapping with each half of each siren sweep */
+const Cue_t lights_boop_siren [] PROGMEM = {
+    LIGHT (   0, EYE_BOTH, HUE_BLUE, 0x10, STROBE_INVERT | 0x02, 0, 0),
+    LIGHT ( 400, EYE_BOTH, HUE_RED,  0x10, STROBE_INVERT | 0x02, 0, 0),
+    LIGHT ( 800, EYE_BOTH, HUE_BLUE, 0x10, STROBE_INVERT | 0x02, 0, 0),
+    LIGHT (1200, EYE_BOTH, HUE_RED,  0x10, STROBE_INVERT | 0x02, 0, 0),
+    LIGHT (1600, EYE_BOTH, HUE_BLUE, 0x10, STROBE_INVERT | 0x02, 0, 0),
+    LIGHT (2000, EYE_BOTH, HUE_RED,  0x10, STROBE_INVERT | 0x02, 0, 0),
+    LIGHT (2400, EYE_BOTH, HUE_BLUE, 0x10, STROBE_INVERT | 0x02, 0, 0),
+    LIGHT (2800, EYE_BOTH, HUE_RED,  0x10, STROBE_INVERT | 0x02, 0, 0),
+    LIGHT (3200, EYE_BOTH, HUE_BLUE, 0x10, STROBE_INVERT | 0x02, 0, 0),
+    LIGHT (3600, EYE_BOTH, HUE_RED,  0x10, STROBE_INVERT | 0x02, 0, 0),
+    END   (4000)
+};
+
+/* Flaring up, with random hues from the clip's hue, then dying back */
+const Cue_t lights_boop_flare [] PROGMEM = {
+    LIGHT (   0, EYE_BOTH, 0, 0x18, 0, 0, 0x1f),
+    LIGHT ( 320, EYE_BOTH, 0, 0x16, 0, 0, 0x1f),
+    LIGHT ( 640, EYE_BOTH, 0, 0x14, 0, 0, 0x1f),
+    LIGHT ( 960, EYE_BOTH, 0, 0x12, 0, 0, 0x1f),
+    END   (1280)
+};
+
+/* Random hues, blinking at random */
+const Cue_t lights_boop_sparkle [] PROGMEM = {
+    LIGHT (  0, EYE_BOTH, 0, 0x18, STROBE_RANDOM, 0, 0xff),
+    END   (640)
+};
+
+/*
+ * The boop clip lights for each mode. The clip's hue and sound come from
+ * the mode's palette.
+ */
+const Cue_t * const mode_boop_lights [MODE_COUNT] PROGMEM = {
+    lights_boop_flicker,
+    lights_boop_strobe,
+    lights_boop_strobe,
+    lights_boop_strobe,
+    lights_boop_strobe,
+    lights_boop_rainbow,
+    lights_boop_rainbow,
+    lights_boop_siren,
+    lights_boop_flare,
+    lights_boop_sparkle
+};
+
+/* Fixed boop sound choices, in BOOP_SOUND_ order */
+const Cue_t * const boop_sounds [BOOP_SOUND_COUNT] PROGMEM = {
+    sound_boop_0,
+    sound_boop_1,
+    sound_boop_2,
+    sound_boop_siren
+};
+
+/* Clip state */
+static uint16_t timeline_ms = 0;
+static uint8_t timeline_frame = 0;
+static uint8_t timeline_hue = 0;
+static const Cue_t *timeline_lights = NULL;     /* Next light cue */
+static const Cue_t *timeline_sound = NULL;      /* Next sound cue */
+static const Cue_t *timeline_eyes [2];          /* Light cue showing on each eye */
+
+/* Tone state */
+static uint16_t timeline_freq = 0;
+static uint8_t timeline_volume = VOLUME_OFF;
+static int8_t timeline_shift = 0;
 
 /*
- * Update the piezo for the current state.
+ * Start a clip, replacing any clip already playing. Either track may be
+ * NULL, and while there is no light track the mode's pattern is shown.
  */
-void tick_sound (void)
+void timeline_play (const Cue_t *lights, const Cue_t *sound, uint8_t hue)
 {
-    static uint8_t update_delay = 0;
+    timeline_ms = 0;
+    timeline_frame = 0;
+    timeline_hue = hue;
+    timeline_lights = lights;
+    timeline_sound = sound;
+    timeline_eyes [0] = NULL;
+    timeline_eyes [1] = NULL;
+
+    timeline_shift = 0;
+    sound_set (0, VOLUME_OFF);
+}
 
-    static uint8_t volume = 0;
-    static uint16_t frequency = 0;
-    static int8_t freq_shift = 0;
+/*
+ * Play the current mode's boop clip.
+ */
+void play_boop (void)
+{
+    const Cue_t *sound;
 
-    if (play_sound == NULL)
+    if (palette [mode].boop_sound < BOOP_SOUND_COUNT)
     {
-        return;
+        sound = pgm_read_ptr (&boop_sounds [palette [mode].boop_sound]);
     }
-
-    if (update_delay == 0)
+    else
     {
-        frequency = pgm_read_word (&(play_sound->freq));
-        volume = pgm_read_byte (&(play_sound->volume));
-        freq_shift = pgm_read_byte (&(play_sound->freq_shift));
+        sound = get_next_boop_sound ();
+    }
 
-        sound_set (frequency, volume);
+    timeline_play (pgm_read_ptr (&mode_boop_lights [mode]), sound, palette [mode].boop_hue);
+}
 
-        if (pgm_read_byte (&(play_sound->duration_ms)))
-        {
-            update_delay = pgm_read_word (&(play_sound->duration_ms)) / 20;
-            play_sound++;
-        }
-        else
-        {
-            play_sound = NULL;
-            return;
-        }
-    }
+/*
+ * Draw one eye from the light cue it is showing.
+ */
+void timeline_eye_draw (const Cue_t *cue, Eye_t eye)
+{
+    uint8_t hue = timeline_hue + pgm_read_byte (&cue->light.hue);
+    uint8_t strobe = pgm_read_byte (&cue->light.strobe);
+    bool lit;
+
+    hue += (int8_t) pgm_read_byte (&cue->shift) * timeline_frame;
+    hue += random8 () & pgm_read_byte (&cue->light.jitter);
 
-    if (update_delay)
+    if (strobe & STROBE_RANDOM)
     {
-        if (freq_shift)
-        {
-            frequency += freq_shift;
-            sound_set (frequency, volume);
-        }
-        update_delay--;
+        lit = random8 () & 0x01;
+    }
+    else
+    {
+        lit = ((timeline_frame & strobe & STROBE_MASK) != 0) == ((strobe & STROBE_INVERT) != 0);
     }
+
+    eye_hsv_set (hue, 0xff, lit ? pgm_read_byte (&cue->level) : 0x00, eye);
 }
 
 /*
- * Update the LED pattern for the current state.
+ * Run the cues that are due, and draw the clip's lights.
+ * Returns true if the clip has taken over the lights.
  */
-#define CYCLE_32_FRAMES     frame = (frame & 0x1f)
-#define CYCLE_64_FRAMES     frame = (frame & 0x3f)
-#define CYCLE_192_FRAMES    frame = (frame % 0xc0)
-#define CYCLE_256_FRAMES
-#define BOOP_32_FRAMES      if (frame == 0x1f) { boop = false; frame = 0; }
-#define BOOP_64_FRAMES      if (frame == 0x3f) { boop = false; frame = 0; }
-#define BOOP_128_FRAMES     if (frame == 0x7f) { boop = false; frame = 0; }
-#define BOOP_256_FRAMES     if (frame == 0xff) { boop = false; frame = 0; }
-
-typedef enum Eye_e {
-    EYE_LEFT,
-    EYE_RIGHT,
-    EYE_BOTH
-} Eye_t;
-
-void eye_hsv_set (uint8_t hue, uint8_t sat, uint8_t val, Eye_t eye)
+bool tick_timeline (void)
 {
-    RGB_t rgb;
+    const Cue_t *cue;
+    bool lit = false;
 
-    hsv2rgb_rainbow (hue, sat, val, &rgb);
+    if (timeline_lights == NULL && timeline_sound == NULL)
+    {
+        return false;
+    }
 
-    switch (eye)
+    /* Sound track */
+    while (timeline_sound != NULL && pgm_read_word (&timeline_sound->time_ms) <= timeline_ms)
     {
-        case EYE_LEFT:
-            memcpy (&pixels [LEFT],  &rgb, 3);
-            break;
-        case EYE_RIGHT:
-            memcpy (&pixels [RIGHT], &rgb, 3);
+        cue = timeline_sound;
+
+        if (pgm_read_byte (&cue->type) == CUE_END)
+        {
+            sound_set (0, VOLUME_OFF);
+            timeline_sound = NULL;
             break;
-        case EYE_BOTH:
-            memcpy (&pixels [LEFT],  &rgb, 3);
-            memcpy (&pixels [RIGHT], &rgb, 3);
-        default:
+        }
+
+        timeline_freq = pgm_read_word (&cue->freq);
+        timeline_volume = pgm_read_byte (&cue->level);
+        timeline_shift = pgm_read_byte (&cue->shift);
+        sound_set (timeline_freq, timeline_volume);
+        timeline_sound++;
+    }
+
+    /* Slide the tone every tick, starting with the tick its cue loads on */
+    if (timeline_sound != NULL && timeline_shift)
+    {
+        timeline_freq += timeline_shift;
+        sound_set (timeline_freq, timeline_volume);
+    }
+
+    /* Light track */
+    while (timeline_lights != NULL && pgm_read_word (&timeline_lights->time_ms) <= timeline_ms)
+    {
+        cue = timeline_lights;
+
+        if (pgm_read_byte (&cue->type) == CUE_END)
+        {
+            timeline_lights = NULL;
             break;
+        }
+
+        if (pgm_read_byte (&cue->light.eye) != EYE_RIGHT)
+        {
+            timeline_eyes [0] = cue;
+        }
+        if (pgm_read_byte (&cue->light.eye) != EYE_LEFT)
+        {
+            timeline_eyes [1] = cue;
+        }
+        timeline_lights++;
     }
-}
 
-uint8_t triangle (uint8_t range, uint8_t period, uint8_t frame)
-{
-    uint16_t half_period = period >> 1;
+    if (timeline_lights != NULL)
+    {
+        /* Each eye is drawn on its own, so that random cues differ between them */
+        if (timeline_eyes [0] != NULL)
+        {
+            timeline_eye_draw (timeline_eyes [0], EYE_LEFT);
+        }
+        if (timeline_eyes [1] != NULL)
+        {
+            timeline_eye_draw (timeline_eyes [1], EYE_RIGHT);
+        }
+        lit = true;
+    }
 
-    return abs ((frame % period) - half_period) * range / half_period;
+    timeline_ms += TIMELINE_TICK_MS;
+    timeline_frame++;
+
+    return lit;
 }
 
 void tick_leds (void)
 {
+    const Palette_t *params = &palette [mode];
+
     memset (pixels, 0, 6);
 
+    /* A clip's lights take over from the mode */
+    if (tick_timeline ())
+    {
+        ticks++;
+        led_show_scaled (pixels, brightness);
+        return;
+    }
+
     switch (mode)
     {
         case 0:
             /* Mode: Purple & Pink
              * Boop: Strobe */
-
-            if (boop)
-            {
-                BOOP_32_FRAMES;
-
-                if (boop && frame == 0)
-                {
-                    play_sound = get_next_boop_sound ();
-                }
-
-                eye_hsv_set ((frame & 0x04) ? HUE_VIOLET : HUE_PINK, 0xff, (frame & 0x02) ? 0x18 : 0, EYE_BOTH);
-            }
-            else
-            {
-                CYCLE_64_FRAMES;
-
-                eye_hsv_set (HUE_VIOLET + triangle (32, 64, frame), 0xff, 0x10, EYE_LEFT);
-                eye_hsv_set (HUE_VIOLET + triangle (32, 64, frame + 32), 0xff, 0x10, EYE_RIGHT);
-            }
-            break;
-
         case 1:
             /* Mode: Orange
              * Boop: Strobe */
-
-            if (boop)
-            {
-                BOOP_32_FRAMES;
-
-                if (boop && frame == 0)
-                {
-                    play_sound = get_next_boop_sound ();
-                }
-
-                eye_hsv_set (HUE_ORANGE, 0xff, (frame & 0x04) ? 0x00 : 0x18, EYE_LEFT);
-                eye_hsv_set (HUE_ORANGE, 0xff, (frame & 0x04) ? 0x18 : 0x00, EYE_RIGHT);
-            }
-            else
-            {
-                CYCLE_64_FRAMES;
-
-                eye_hsv_set (HUE_ORANGE - 0x10 + triangle (32, 64, frame), 0xff, 0x10, EYE_LEFT);
-                eye_hsv_set (HUE_ORANGE - 0x10 + triangle (32, 64, frame + 32), 0xff, 0x10, EYE_RIGHT);
-            }
-            break;
-
         case 2:
             /* Mode: Red
              * Boop: Strobe */
-
-            if (boop)
-            {
-                BOOP_32_FRAMES;
-
-                if (boop && frame == 0)
-                {
-                    play_sound = get_next_boop_sound ();
-                }
-
-                eye_hsv_set (HUE_RED, 0xff, (frame & 0x04) ? 0x00 : 0x18, EYE_LEFT);
-                eye_hsv_set (HUE_RED, 0xff, (frame & 0x04) ? 0x18 : 0x00, EYE_RIGHT);
-            }
-            else
-            {
-                CYCLE_64_FRAMES;
-
-                eye_hsv_set (HUE_RED - 0x10 + triangle (32, 64, frame), 0xff, 0x10, EYE_LEFT);
-                eye_hsv_set (HUE_RED - 0x10 + triangle (32, 64, frame + 32), 0xff, 0x10, EYE_RIGHT);
-            }
-            break;
-
         case 3:
             /* Mode: Green
              * Boop: Strobe */
-
-            if (boop)
-            {
-                BOOP_32_FRAMES;
-
-                if (boop && frame == 0)
-                {
-                    play_sound = get_next_boop_sound ();
-                }
-
-                eye_hsv_set (HUE_GREEN, 0xff, (frame & 0x04) ? 0x00 : 0x18, EYE_LEFT);
-                eye_hsv_set (HUE_GREEN, 0xff, (frame & 0x04) ? 0x18 : 0x00, EYE_RIGHT);
-            }
-            else
-            {
-                CYCLE_64_FRAMES;
-
-                eye_hsv_set (HUE_GREEN - 0x10 + triangle (32, 64, frame), 0xff, 0x10, EYE_LEFT);
-                eye_hsv_set (HUE_GREEN - 0x10 + triangle (32, 64, frame + 32), 0xff, 0x10, EYE_RIGHT);
-            }
-            break;
-
         case 4:
             /* Mode: Blue
              * Boop: Strobe */
+            frame = frame % params->period;
 
-            if (boop)
-            {
-                BOOP_32_FRAMES;
-
-                if (boop && frame == 0)
-                {
-                    play_sound = get_next_boop_sound ();
-                }
-
-                eye_hsv_set (HUE_AQUA + 0x10, 0xff, (frame & 0x04) ? 0x00 : 0x18, EYE_LEFT);
-                eye_hsv_set (HUE_AQUA + 0x10, 0xff, (frame & 0x04) ? 0x18 : 0x00, EYE_RIGHT);
-            }
-            else
-            {
-                CYCLE_64_FRAMES;
-
-                eye_hsv_set (HUE_AQUA - 0x10 + triangle (32, 64, frame), 0xff, 0x10, EYE_LEFT);
-                eye_hsv_set (HUE_AQUA - 0x10 + triangle (32, 64, frame + 32), 0xff, 0x10, EYE_RIGHT);
-            }
+            eye_hsv_set (params->hue + triangle (params->swing, params->period, frame),
+                         0xff, params->val, EYE_LEFT);
+            eye_hsv_set (params->hue + triangle (params->swing, params->period, frame + (params->period >> 1)),
+                         0xff, params->val, EYE_RIGHT);
             break;
 
         case 5:
             /* Mode: Rainbow
              * Boop: Bright, fast, and crazy */
-            if (boop)
-            {
-                BOOP_128_FRAMES;
-
-                if (boop && frame == 0)
-                {
-                    play_sound = get_next_boop_sound ();
-                }
-
-                eye_hsv_set ((frame << 2) +  64, 0xff, 0x18, EYE_LEFT);
-                eye_hsv_set ((frame << 2) + 192, 0xff, 0x18, EYE_RIGHT);
-            }
-            else
-            {
-                CYCLE_256_FRAMES;
-                eye_hsv_set ((frame << 1), 0xff, 0x10, EYE_BOTH);
-            }
+            CYCLE_256_FRAMES;
+            eye_hsv_set (params->hue + frame * params->swing, 0xff, params->val, EYE_BOTH);
             break;
 
         case 6:
             /* Mode: Rainbow-crossed
              * Boop: Bright, fast, and crazy */
-            if (boop)
-            {
-                BOOP_128_FRAMES;
-
-                if (boop && frame == 0)
-                {
-                    play_sound = get_next_boop_sound ();
-                }
-
-                eye_hsv_set ((frame << 2) +  64, 0xff, 0x18, EYE_LEFT);
-                eye_hsv_set ((frame << 2) + 192, 0xff, 0x18, EYE_RIGHT);
-            }
-            else
-            {
-                CYCLE_256_FRAMES;
-                eye_hsv_set ((frame << 1),       0xff, 0x10, EYE_LEFT);
-                eye_hsv_set ((frame << 1) + 128, 0xff, 0x10, EYE_RIGHT);
-            }
+            CYCLE_256_FRAMES;
+            eye_hsv_set (params->hue + frame * params->swing,       0xff, params->val, EYE_LEFT);
+            eye_hsv_set (params->hue + frame * params->swing + 128, 0xff, params->val, EYE_RIGHT);
             break;
 
         case 7:
             /* Mode: Pirihimana
              * Boop: Pirihi-strobe */
         default:
-            if (boop)
+            frame = frame % params->period;
+
+            if (frame >= (params->period >> 1))
             {
-                BOOP_256_FRAMES;
-
-                if (boop && frame == 0)
-                {
-                    play_sound = sound_boop_siren;
-                }
-
-                if ((frame / 12) & 1)
-                {
-                    /* Red */
-                    eye_hsv_set (HUE_RED,  0xff, (frame & 0x02) ? 0x10 : 0x00, EYE_BOTH);
-                }
-                else
-                {
-                    /* Blue */
-                    eye_hsv_set (HUE_BLUE, 0xff, (frame & 0x02) ? 0x10 : 0x00, EYE_BOTH);
-                }
+                eye_hsv_set (params->hue,                 0xff, params->val, EYE_LEFT);
+                eye_hsv_set (params->hue + params->swing, 0xff, params->val, EYE_RIGHT);
             }
             else
             {
-                CYCLE_32_FRAMES;
-
-                if (frame & 0x08)
-                {
-                    eye_hsv_set (HUE_RED,  0xff, 0x08, EYE_LEFT);
-                    eye_hsv_set (HUE_BLUE, 0xff, 0x08, EYE_RIGHT);
-                }
-                else
-                {
-                    eye_hsv_set (HUE_BLUE, 0xff, 0x08, EYE_LEFT);
-                    eye_hsv_set (HUE_RED,  0xff, 0x08, EYE_RIGHT);
-                }
+                eye_hsv_set (params->hue + params->swing, 0xff, params->val, EYE_LEFT);
+                eye_hsv_set (params->hue,                 0xff, params->val, EYE_RIGHT);
+            }
+            break;
+
+        case 8:
+            /* Mode: Fire
+             * Boop: Flare */
+            CYCLE_256_FRAMES;
+
+            /* Slow noise for the flame, with a little random flicker on top */
+            eye_hsv_set (params->hue + (((uint16_t) noise8 (ticks << 5) * params->swing) >> 8), 0xff,
+                         params->val + (noise8 ((ticks << 5) + 0x8000) >> 4) + (random8 () & 0x03), EYE_LEFT);
+            eye_hsv_set (params->hue + (((uint16_t) noise8 ((ticks << 5) + 0x4000) * params->swing) >> 8), 0xff,
+                         params->val + (noise8 ((ticks << 5) + 0xc000) >> 4) + (random8 () & 0x03), EYE_RIGHT);
+            break;
+
+        case 9:
+            /* Mode: Starlight
+             * Boop: Sparkle burst */
+            frame = frame % params->period;
+
+            /* Breathing, with noise to keep it from looking mechanical */
+            eye_hsv_set (params->hue + (((uint16_t) noise8 (ticks << 4) * params->swing) >> 8), 0xff,
+                         params->val + triangle (12, params->period, frame) + (noise8 ((ticks << 4) + 0x8000) >> 6), EYE_BOTH);
+
+            /* The occasional twinkle */
+            if (random8 () < 0x04)
+            {
+                eye_hsv_set (0, 0x00, 0x10, (random8 () & 0x01) ? EYE_LEFT : EYE_RIGHT);
             }
             break;
     }
 
     frame++;
+    ticks++;
 
-    led_show (pixels);
+    led_show_scaled (pixels, brightness);
 }
 
 /*
@@ -521,50 +624,92 @@ void tick_leds (void)
  */
 void tick_state (void)
 {
-    static uint8_t boop_length = 0;
-    static uint8_t boop_holdoff = 0;
+    static uint8_t press_mode = 0;
+    Gesture_t gesture;
+
+    boop_sample ();
 
-    /* Debounce the booper */
-    if (boop_holdoff)
+    while ((gesture = boop_gesture_get ()) != GESTURE_NONE)
     {
-        boop_holdoff--;
-        return;
+        switch (gesture)
+        {
+            case GESTURE_PRESS:
+                idle_ticks = 0;
+
+                /* The timing of boops is our source of entropy */
+                random_stir (ticks);
+
+                /* Remembered in case this becomes a long-hold */
+                press_mode = mode;
+
+                /* To keep the short-boop responsive, trigger it right away */
+                play_boop ();
+                break;
+
+            case GESTURE_HOLD:
+                /* A long-boop should cancel the short-boop and instead cycle
+                 * through modes, one more each time the hold repeats */
+                mode = (mode + 1) % MODE_COUNT;
+
+                /* Beep */
+                timeline_play (NULL, sound_mode_change, 0);
+                break;
+
+            case GESTURE_LONG_HOLD:
+                /* Undo the mode changes from the hold, and go to sleep */
+                mode = press_mode;
+                standby_request = true;
+                break;
+
+            /* Taps and double-taps are left for modes to use later */
+            default:
+                break;
+        }
     }
 
-    /* Check for a boop */
-    if (boop_sense () > 0x02)
+    /* Go to sleep if nobody has booped us for a while. This comes after
+     * the gestures, so that a boop on the last tick keeps us awake. */
+    if (++idle_ticks >= STANDBY_TIMEOUT_TICKS)
     {
-        boop_length++;
+        standby_request = true;
+    }
+}
 
-        /* To keep the short-boop responsive, trigger it right away */
-        if (boop_length == 1)
-        {
-            boop = true;
-            frame = 0;
-        }
+/*
+ * Measure the supply and act on each new reading.
+ */
+void tick_battery (void)
+{
+    static uint16_t rebaseline_reading = 0;
+    static uint8_t warn_countdown = 0;
 
-        /* A long-boop should cancel the short-boop and instead cycle through modes */
-        if ((boop_length & 0x3f) == 0x20)
-        {
-            mode = (mode + 1) % MODE_COUNT;
-            boop = false;
+    if (!battery_tick ())
+    {
+        return;
+    }
 
-            /* Don't overflow, even for very long boops */
-            if (boop_length > 0x20)
-            {
-                boop_length = 0x20;
-            }
+    brightness = battery_brightness ();
 
-            /* Beep */
-            play_sound = sound_mode_change;
-        }
+    /* The booper's fall time drifts with the supply */
+    if (abs ((int16_t) (battery_reading () - rebaseline_reading)) >= BATTERY_REBASELINE_DELTA)
+    {
+        rebaseline_reading = battery_reading ();
+        boop_rebaseline ();
     }
 
-    /* The current boop has completed, start the hold-off timer */
-    else if (boop_length)
+    if (battery_low ())
     {
-        boop_holdoff = 16;
-        boop_length = 0;
+        if (warn_countdown == 0)
+        {
+            warn_countdown = BATTERY_WARN_READINGS;
+            timeline_play (lights_low_battery, sound_low_battery, 0);
+        }
+
+        warn_countdown--;
+    }
+    else
+    {
+        warn_countdown = 0;
     }
 }
 
@@ -573,9 +718,120 @@ void tick_state (void)
  */
 ISR (TIMER0_COMPA_vect)
 {
-    tick_sound ();
-    tick_leds ();
+    /* Sense first, so that a new boop is shown in this same tick */
     tick_state ();
+    tick_leds ();
+    tick_battery ();
+}
+
+/*
+ * Only used to wake from standby.
+ */
+EMPTY_INTERRUPT (WDT_vect);
+
+/*
+ * Power down until woken by the watchdog, after a WDTO_ period.
+ */
+void standby_sleep (uint8_t period)
+{
+    /* Restart the count before changing the timeout, or a shorter one
+     * fires as soon as the count already passed it */
+    cli ();
+    wdt_reset ();
+    WDTCR = (1 << WDCE) | (1 << WDE);
+    WDTCR = (1 << WDIE) | period;
+
+    sleep_enable ();
+#ifdef sleep_bod_disable
+    sleep_bod_disable ();
+#endif
+    sei ();
+    sleep_cpu ();
+    sleep_disable ();
+}
+
+/*
+ * Ultra-low-power standby. The lights, piezo and timers are stopped and
+ * the CPU is powered down, waking on the watchdog about four times per
+ * second to check for a boop. Returns as soon as one is seen.
+ */
+void standby (void)
+{
+    uint16_t wake_level = 0;
+    uint16_t level;
+    uint8_t i;
+
+    /* Stop the tick */
+    TIMSK &= ~0x10;
+    TCCR0B = 0x00;
+
+#ifdef STACK_PAINT
+    /* A quiet moment to record how deep the stack has been */
+    stack_report ();
+#endif
+
+    /* Lights and piezo off */
+    memset (pixels, 0, 6);
+    led_show (pixels);
+    timeline_play (NULL, NULL, 0);
+    TCCR1 = 0x00;
+    battery_stop ();
+
+    set_sleep_mode (SLEEP_MODE_PWR_DOWN);
+
+    /* Don't wake straight back up from the boop that sent us here. Something
+     * may be left pressing on the booper, so wait for it powered down. */
+    while (boop_sense () > BOOP_THRESHOLD)
+    {
+        standby_sleep (WDTO_2S);
+    }
+
+    /* The booper charges for a watchdog period below, rather than the 10 ms
+     * that the baseline was taken with, so find its untouched level that way */
+    for (i = 0; i < STANDBY_BASELINE_SAMPLES; i++)
+    {
+        boop_charge ();
+        standby_sleep (WDTO_15MS);
+        wake_level += boop_measure ();
+    }
+    wake_level = wake_level / STANDBY_BASELINE_SAMPLES + BOOP_THRESHOLD;
+
+    while (true)
+    {
+        standby_sleep (WDTO_250MS);
+
+        /* The booper charges while we sleep, rather than in a delay loop */
+        boop_charge ();
+        standby_sleep (WDTO_15MS);
+
+        level = boop_measure ();
+
+        if (level > wake_level)
+        {
+            break;
+        }
+
+        /* Follow the untouched level down, in case it was touched while the level was taken */
+        if (level + BOOP_THRESHOLD < wake_level)
+        {
+            wake_level = level + BOOP_THRESHOLD;
+        }
+    }
+
+    /* Watchdog off */
+    cli ();
+    WDTCR = (1 << WDCE) | (1 << WDE);
+    WDTCR = 0x00;
+    sei ();
+
+    /* Resume the previous mode, with the waking boop seen as a new boop */
+    boop_reset ();
+    idle_ticks = 0;
+    standby_request = false;
+    TCCR1  = 0x09;
+    TCNT0  = 0x00;
+    TCCR0B = 0x05;
+    TIMSK |= 0x10;
 }
 
 /*
@@ -595,6 +851,16 @@ int main (void)
     /* Output: LED Data */
     DDRB |= (1 << DDB2);
 
+    palette_load ();
+
+#ifdef NOISE_BENCHMARK
+    /* Timer0 is free until the tick starts */
+    noise_benchmark ();
+#endif
+
+    /* The analog comparator is unused */
+    ACSR |= (1 << ACD);
+
     boop_calibrate ();
 
     /* Use Timer0 for the 50 Hz tick interrupt */
@@ -614,6 +880,11 @@ int main (void)
 
     while (true)
     {
+        if (standby_request)
+        {
+            standby ();
+        }
+
         _delay_ms (10);
     }
 }
@@ -0,0 +1,111 @@
+/*
+ * Supply voltage monitoring.
+ *
+ * Each measurement is spread across three ticks, so that no tick waits on
+ * the ADC: one to power up the ADC and let the bandgap settle, one to start
+ * the conversion, and one to collect the result and power the ADC back down.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <avr/io.h>
+
+#include "battery.h"
+
+#define ADMUX_BANDGAP   0x0c /* Vcc reference, measuring the 1.1 V bandgap */
+#define ADCSRA_ON       0x86 /* ADC enabled, prescale clock down to 125 kHz */
+
+typedef enum BatteryStep_e {
+    BATTERY_WAIT,
+    BATTERY_SETTLE,
+    BATTERY_CONVERT
+} BatteryStep_t;
+
+static uint8_t battery_step = BATTERY_WAIT;
+static uint16_t battery_countdown = 0;
+static uint16_t battery_adc = BATTERY_ADC (BATTERY_DIM_MV);
+
+/*
+ * Advance the measurement by one step. Returns true when a new reading is ready.
+ */
+bool battery_tick (void)
+{
+    switch (battery_step)
+    {
+        case BATTERY_WAIT:
+            if (battery_countdown)
+            {
+                battery_countdown--;
+                break;
+            }
+
+            ADMUX = ADMUX_BANDGAP;
+            ADCSRA = ADCSRA_ON;
+            battery_step = BATTERY_SETTLE;
+            break;
+
+        case BATTERY_SETTLE:
+            ADCSRA |= (1 << ADSC);
+            battery_step = BATTERY_CONVERT;
+            break;
+
+        case BATTERY_CONVERT:
+        default:
+            /* The conversion takes 200 us, so will have long finished */
+            battery_adc = ADCW;
+            battery_stop ();
+            return true;
+    }
+
+    return false;
+}
+
+/*
+ * Power down the ADC, abandoning any measurement in progress.
+ */
+void battery_stop (void)
+{
+    ADCSRA = 0x00;
+    battery_step = BATTERY_WAIT;
+    battery_countdown = BATTERY_PERIOD_TICKS;
+}
+
+/*
+ * The most recent reading.
+ */
+uint16_t battery_reading (void)
+{
+    return battery_adc;
+}
+
+/*
+ * Master brightness for the supply voltage: full down to BATTERY_DIM_MV,
+ * then falling to BATTERY_DIM_MIN at BATTERY_LOW_MV. Drawing less current
+ * keeps a sagging cell above brown-out for longer.
+ */
+uint8_t battery_brightness (void)
+{
+    const uint16_t dim = BATTERY_ADC (BATTERY_DIM_MV);
+    const uint16_t low = BATTERY_ADC (BATTERY_LOW_MV);
+
+    if (battery_adc <= dim)
+    {
+        return 0xff;
+    }
+
+    if (battery_adc >= low)
+    {
+        return BATTERY_DIM_MIN;
+    }
+
+    return 0xff - (uint16_t) (battery_adc - dim) * (0xff - BATTERY_DIM_MIN) / (low - dim);
+}
+
+/*
+ * True if the most recent reading is below BATTERY_LOW_MV.
+ */
+bool battery_low (void)
+{
+    return battery_adc > BATTERY_ADC (BATTERY_LOW_MV);
+}
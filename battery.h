@@ -0,0 +1,19 @@
+/*
+ * Supply voltage monitoring, measuring the internal 1.1 V bandgap against
+ * Vcc. Readings are raw ADC values, which rise as the supply falls.
+ */
+
+/* The ADC reading of the bandgap for a supply voltage in mV */
+#define BATTERY_ADC(mv) ((uint16_t) (1100UL * 1024 / (mv)))
+
+#define BATTERY_PERIOD_TICKS 500    /* Ten seconds between measurements */
+
+#define BATTERY_DIM_MV      3600    /* Below this, the LEDs are dimmed */
+#define BATTERY_LOW_MV      3300    /* Below this, warn that the battery is low */
+#define BATTERY_DIM_MIN     0x60    /* Master brightness at BATTERY_LOW_MV and below */
+
+bool battery_tick (void);
+void battery_stop (void);
+uint16_t battery_reading (void);
+uint8_t battery_brightness (void);
+bool battery_low (void);
@@ -0,0 +1,267 @@
+/*
+ * Boop sensing, event queue and gesture recognition.
+ *
+ * boop_sample () turns sensor readings into timestamped press and release
+ * events, and boop_gesture_get () turns those events into gestures.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <avr/io.h>
+#include <util/delay.h>
+
+#include "boop.h"
+
+#define BOOP_QUEUE_SIZE 4 /* Must be a power of two */
+#define BOOP_REBASELINE_SAMPLES 8
+
+static uint16_t boop_baseline = 0;
+static uint16_t boop_raw = 0;
+static uint16_t rebaseline_sum = 0;
+static uint8_t rebaseline_samples = 0;
+
+/* Sensing */
+static uint8_t boop_time = 0;
+static bool boop_down = false;
+
+/* Event queue */
+static BoopEvent_t boop_queue [BOOP_QUEUE_SIZE];
+static uint8_t boop_queue_head = 0;
+static uint8_t boop_queue_tail = 0;
+
+/* Gesture recogniser */
+static bool gesture_pressed = false;
+static bool gesture_tap_pending = false;
+static uint8_t gesture_held = GESTURE_NONE;
+static uint8_t gesture_press_time = 0;
+static uint8_t gesture_tap_time = 0;
+static uint16_t gesture_repeat_time = 0;
+
+/*
+ * Charge the boop sensor, ready for boop_measure ().
+ */
+void boop_charge (void)
+{
+    /* Set the driven pin high */
+    PORTB |= (1 << 1);
+}
+
+/*
+ * Time the boop sensor discharging, subtracting the baseline if one has been set.
+ */
+uint16_t boop_measure (void)
+{
+    uint16_t fall_time = 0;
+
+    /* Set the driven pin low */
+    PORTB &= ~(1 << 1);
+
+    /* Time the falling edge, in loops */
+    while (PINB & 0x01)
+    {
+        fall_time++;
+    }
+
+    boop_raw = fall_time;
+
+    if (fall_time < boop_baseline)
+    {
+        fall_time = boop_baseline;
+    }
+
+    return fall_time - boop_baseline;
+}
+
+/*
+ * Read the boop sensor, subtracting the baseline if one has been set.
+ */
+uint16_t boop_sense (void)
+{
+    boop_charge ();
+    _delay_ms (10);
+
+    return boop_measure ();
+}
+
+/*
+ * Get a baseline non-boop reading to subtract from future readings.
+ */
+void boop_calibrate (void)
+{
+    uint16_t boop_sum = 0;
+    for (int i = 0; i < 10; i++)
+    {
+        boop_sum += boop_sense ();
+        _delay_ms (50);
+    }
+
+    boop_baseline = boop_sum / 10;
+}
+
+/*
+ * Take a new baseline from the next few samples without a boop, such as
+ * after the supply voltage has changed.
+ */
+void boop_rebaseline (void)
+{
+    rebaseline_sum = 0;
+    rebaseline_samples = BOOP_REBASELINE_SAMPLES;
+}
+
+/*
+ * Add an event to the queue. If the queue is full, the event is dropped.
+ */
+static void boop_event_put (BoopEventType_t type, uint8_t time)
+{
+    uint8_t next = (boop_queue_head + 1) & (BOOP_QUEUE_SIZE - 1);
+
+    if (next == boop_queue_tail)
+    {
+        return;
+    }
+
+    boop_queue [boop_queue_head].type = type;
+    boop_queue [boop_queue_head].time = time;
+    boop_queue_head = next;
+}
+
+/*
+ * Take the oldest event from the queue.
+ */
+static bool boop_event_get (BoopEvent_t *event)
+{
+    if (boop_queue_tail == boop_queue_head)
+    {
+        return false;
+    }
+
+    *event = boop_queue [boop_queue_tail];
+    boop_queue_tail = (boop_queue_tail + 1) & (BOOP_QUEUE_SIZE - 1);
+
+    return true;
+}
+
+/*
+ * Take one sensor reading, queueing an event if the boop has started or ended.
+ */
+void boop_sample (void)
+{
+    static uint8_t quiet_samples = 0;
+
+    boop_time++;
+
+    if (boop_sense () > BOOP_THRESHOLD)
+    {
+        quiet_samples = 0;
+
+        /* Report the press on the first sample that sees it */
+        if (!boop_down)
+        {
+            boop_down = true;
+            boop_event_put (BOOP_EVENT_PRESS, boop_time);
+        }
+    }
+
+    /* Debounce the release, timestamping it from the first quiet sample */
+    else if (boop_down && ++quiet_samples == BOOP_RELEASE_SAMPLES)
+    {
+        boop_down = false;
+        boop_event_put (BOOP_EVENT_RELEASE, boop_time - (BOOP_RELEASE_SAMPLES - 1));
+    }
+
+    if (rebaseline_samples && !boop_down)
+    {
+        rebaseline_sum += boop_raw;
+
+        if (--rebaseline_samples == 0)
+        {
+            boop_baseline = rebaseline_sum / BOOP_REBASELINE_SAMPLES;
+        }
+    }
+}
+
+/*
+ * Forget any boop in progress, such as after the sensor has been read
+ * directly by standby.
+ */
+void boop_reset (void)
+{
+    boop_down = false;
+    boop_queue_tail = boop_queue_head;
+    gesture_pressed = false;
+    gesture_tap_pending = false;
+}
+
+/*
+ * Get the next gesture. Call until GESTURE_NONE is returned.
+ */
+Gesture_t boop_gesture_get (void)
+{
+    BoopEvent_t event;
+    uint8_t length;
+
+    while (boop_event_get (&event))
+    {
+        if (event.type == BOOP_EVENT_PRESS)
+        {
+            gesture_pressed = true;
+            gesture_held = GESTURE_NONE;
+            gesture_press_time = event.time;
+            return GESTURE_PRESS;
+        }
+
+        gesture_pressed = false;
+
+        /* A hold is not also a tap */
+        if (gesture_held != GESTURE_NONE)
+        {
+            gesture_tap_pending = false;
+            continue;
+        }
+
+        if (gesture_tap_pending && (uint8_t) (event.time - gesture_tap_time) <= GESTURE_DOUBLE_TAP_SAMPLES)
+        {
+            gesture_tap_pending = false;
+            return GESTURE_DOUBLE_TAP;
+        }
+
+        gesture_tap_pending = true;
+        gesture_tap_time = event.time;
+        return GESTURE_TAP;
+    }
+
+    /* Holds are reported while the boop is still in progress */
+    if (gesture_pressed)
+    {
+        length = boop_time - gesture_press_time;
+
+        if (gesture_held == GESTURE_NONE && length >= GESTURE_HOLD_SAMPLES)
+        {
+            gesture_held = GESTURE_HOLD;
+            gesture_repeat_time = GESTURE_HOLD_SAMPLES + GESTURE_HOLD_REPEAT_SAMPLES;
+            return GESTURE_HOLD;
+        }
+
+        if (gesture_held == GESTURE_HOLD && length >= GESTURE_LONG_HOLD_SAMPLES)
+        {
+            gesture_held = GESTURE_LONG_HOLD;
+            return GESTURE_LONG_HOLD;
+        }
+
+        /* Wider than the press length, so that the last repeat cannot wrap around */
+        if (gesture_held == GESTURE_HOLD && length >= gesture_repeat_time)
+        {
+            gesture_repeat_time += GESTURE_HOLD_REPEAT_SAMPLES;
+            return GESTURE_HOLD;
+        }
+    }
+
+    /* Expire the first tap before the timestamps can wrap around */
+    else if (gesture_tap_pending && (uint8_t) (boop_time - gesture_tap_time) > GESTURE_DOUBLE_TAP_SAMPLES)
+    {
+        gesture_tap_pending = false;
+    }
+
+    return GESTURE_NONE;
+}
@@ -0,0 +1,45 @@
+/*
+ * Boop sensing, event queue and gesture recognition.
+ *
+ * Times are in samples, with one sample taken per 20 ms tick.
+ */
+
+/* Sensor reading (above baseline) that counts as a boop */
+#define BOOP_THRESHOLD 0x02
+
+/* Consecutive quiet samples needed before a boop is released */
+#define BOOP_RELEASE_SAMPLES 2
+
+/* Gesture windows, in samples. All must be less than 256. */
+#define GESTURE_DOUBLE_TAP_SAMPLES  15  /* Release-to-release gap for a double-tap */
+#define GESTURE_HOLD_SAMPLES        32  /* Press length for a hold */
+#define GESTURE_HOLD_REPEAT_SAMPLES 64  /* Between repeated holds while still held */
+#define GESTURE_LONG_HOLD_SAMPLES  250  /* Press length for a long-hold, ending the repeats */
+
+typedef enum BoopEventType_e {
+    BOOP_EVENT_PRESS,
+    BOOP_EVENT_RELEASE
+} BoopEventType_t;
+
+typedef struct BoopEvent_s {
+    uint8_t type;
+    uint8_t time;
+} BoopEvent_t;
+
+typedef enum Gesture_e {
+    GESTURE_NONE,
+    GESTURE_PRESS,      /* Sent on the sample the boop starts */
+    GESTURE_TAP,        /* Released before becoming a hold */
+    GESTURE_DOUBLE_TAP, /* Second tap inside the double-tap window */
+    GESTURE_HOLD,       /* Sent while still held, then repeated until a long-hold */
+    GESTURE_LONG_HOLD   /* Sent once, while still held */
+} Gesture_t;
+
+void boop_charge (void);
+uint16_t boop_measure (void);
+uint16_t boop_sense (void);
+void boop_calibrate (void);
+void boop_rebaseline (void);
+void boop_sample (void);
+void boop_reset (void);
+Gesture_t boop_gesture_get (void);
@@ -5,6 +5,14 @@
 # Configuration
 TTY="/dev/ttyUSB0"
 
+# Report the worst-case static stack depth against the free RAM, without
+# touching the chip. Needs avr-gcc 10 or newer (see tools/stack_report.sh).
+# Usage: ./build.sh stackcheck, or MCU=attiny85 ./build.sh stackcheck
+if [ "$1" = "stackcheck" ]
+then
+    exec tools/stack_report.sh
+fi
+
 # Auto-detect chip by providing the wrong part number and checking the error
 LINE="$(avrdude -c avr910 -P ${TTY} -p ATtiny2313 -q 2>&1 | grep 'Device signature')"
 if $(echo "${LINE}" | grep -q "probably t85")
@@ -22,8 +30,70 @@ else
     exit 1
 fi
 
+# Write a palette EEPROM image, leaving the flash alone
+# Usage: ./build.sh palette palette.hex (see tools/palette_image.c)
+if [ "$1" = "palette" ]
+then
+    echo "Writing ${2} to EEPROM..."
+    avrdude -p ${CHIP} -c avr910 -P ${TTY} -U eeprom:w:${2}:i
+    exit
+fi
+
+# Set the EESAVE fuse, so that EEPROM (the palette) survives the chip erase
+# before each flash. Without it, reflashing returns to the default palette.
+# Usage: ./build.sh eesave
+if [ "$1" = "eesave" ]
+then
+    HFUSE="$(avrdude -p ${CHIP} -c avr910 -P ${TTY} -U hfuse:r:-:h 2>&1 | grep -x '0x[0-9a-fA-F]\{1,2\}')"
+    if [ -z "${HFUSE}" ]
+    then
+        echo "Could not read the H-fuse. Exiting."
+        exit 1
+    elif [ $((HFUSE & 0x08)) -eq 0 ]
+    then
+        echo "H-fuse ${HFUSE} already has EESAVE set"
+    else
+        HFUSE="$(printf '0x%02x' $((HFUSE & ~0x08)))"
+        echo "Writing H-fuse to ${HFUSE}"
+        avrdude -p ${CHIP} -c avr910 -P ${TTY} -U hfuse:w:${HFUSE}:m
+    fi
+    exit
+fi
+
+# Read back the stack headroom saved by a STACK_PAINT build (see stack.h)
+# Usage: ./build.sh stack
+if [ "$1" = "stack" ]
+then
+    HEADROOM="$(avrdude -p ${CHIP} -c avr910 -P ${TTY} -U eeprom:r:-:r 2> /dev/null | tail -c 2 | od -An -tu2)"
+    echo "Stack headroom: ${HEADROOM} bytes never used"
+    exit
+fi
+
+# Read back the cycles per call saved by a NOISE_BENCHMARK build (see noise.h)
+# Usage: ./build.sh cycles
+if [ "$1" = "cycles" ]
+then
+    CYCLES="$(avrdude -p ${CHIP} -c avr910 -P ${TTY} -U eeprom:r:-:r 2> /dev/null | tail -c 6 | head -c 4 | od -An -tu2)"
+    echo "Cycles per call (random8, noise8, 65535 if over 2040): ${CYCLES}"
+    exit
+fi
+
+# Paint free RAM to measure the stack high-water mark
+# Usage: STACK_PAINT=1 ./build.sh
+if [ -n "${STACK_PAINT}" ]
+then
+    DEFINES="${DEFINES} -DSTACK_PAINT"
+fi
+
+# Measure random8 () and noise8 () at startup
+# Usage: NOISE_BENCHMARK=1 ./build.sh
+if [ -n "${NOISE_BENCHMARK}" ]
+then
+    DEFINES="${DEFINES} -DNOISE_BENCHMARK"
+fi
+
 # Compile
-avr-gcc -g -Os -Wall -mcall-prologues -mmcu=${GCC_CHIP} *.c -o badge.obj || exit
+avr-gcc -g -Os -Wall -DF_CPU=8000000UL ${DEFINES} -mcall-prologues -mmcu=${GCC_CHIP} *.c -o badge.obj || exit
 
 # Generate .hex
 avr-objcopy -R .eeprom -O ihex badge.obj badge.hex || exit
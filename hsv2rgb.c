@@ -5,11 +5,7 @@
 #include <stdint.h>
 
 #include "rgb.h"
-
-static uint8_t scale8 (uint16_t i, uint16_t scale)
-{
-    return (uint16_t)((i * (1 + scale)) >> 8);
-}
+#include "scale8.h"
 
 void hsv2rgb_rainbow (uint8_t hue, uint8_t sat, uint8_t val, RGB_t *rgb)
 {
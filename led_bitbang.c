@@ -104,3 +104,146 @@ void led_show(uint8_t *data)
           [hi]    "r"  (hi),
           [lo]    "r"  (lo));
 }
+
+/*
+ * As led_show, but with every byte scaled by (brightness + 1) / 256 on its
+ * way out, so 0xff leaves the data unchanged.
+ *
+ * The next byte is scaled by a shift-and-add multiply while the current
+ * byte is sent, one step per bit: "sbrc; add" fills the idle cycles of the
+ * low phase and "ror; clc" fills those of the following high phase. The
+ * last step, loading the byte after, and the loop counter no longer fit,
+ * so the low phase of each byte's final bit is stretched:
+ *
+ *   Bits 7..1: 10 clocks, HH_____LLL              (as led_show)
+ *   Bit 0:     18 clocks, HH_____LLLLLLLLLLL
+ *   Out instructions: T=0, T=2, T=7, next bit at T=18
+ *
+ * At 8 MHz the high times are unchanged (250 ns / 875 ns). After a final
+ * 1 bit the line is low from T=7, for 11 clocks (1.375 us). After a final
+ * 0 bit it is low from T=2, for 16 clocks (2.0 us), up from 8 clocks
+ * (1.0 us) in led_show. WS2812s only latch on a low time of 50 us or more,
+ * and parts tested in practice accept low times up to around 5 us between
+ * bits without error. tools/ws2812_timing checks these times and the
+ * scaled output by running this asm on a cycle-counting model; it has not
+ * been checked against an assembled listing or a scope.
+ */
+void led_show_scaled (uint8_t *data, uint8_t brightness)
+{
+    volatile uint16_t num_bytes = 6;
+    volatile uint8_t *ptr = data;
+    volatile uint8_t b = ((uint16_t) *ptr++ * (brightness + 1)) >> 8; /* Current byte value, scaled */
+    volatile uint8_t next = *ptr++; /* Next byte value, unscaled */
+    volatile uint8_t acc = 0; /* Next byte value, being scaled */
+    volatile uint8_t hi; /* PORTB with output bit set high */
+    volatile uint8_t lo; /* PORTB with output bit set low */
+    volatile uint8_t n1 = 0; /* First bit out */
+    volatile uint8_t n2 = 0; /* Next bit out */
+
+    hi = PORTB |  (1 << PB2);
+    lo = PORTB & ~(1 << PB2);
+
+    /* Set up the first bit out */
+    n1 = (b & 0x80) ? hi : lo;
+
+    asm volatile (
+        "headS%=:                        \n\t"
+        "out    %[port],    %[hi]       \n\t"
+        "mov    %[n2],      %[lo]       \n\t"
+        "out    %[port],    %[n1]       \n\t"
+        "mov    %[acc],     %[next]     \n\t"
+        "clc                             \n\t"
+        "sbrc   %[byte],    6           \n\t"
+        "mov    %[n2],      %[hi]       \n\t"
+        "out    %[port],    %[lo]       \n\t"
+        "sbrc   %[bright],  0           \n\t"
+        "add    %[acc],     %[next]     \n\t"
+        "out    %[port],    %[hi]       \n\t"
+        "mov    %[n1],      %[lo]       \n\t"
+        "out    %[port],    %[n2]       \n\t"
+        "ror    %[acc]                  \n\t"
+        "clc                             \n\t"
+        "sbrc   %[byte],    5           \n\t"
+        "mov    %[n1],      %[hi]       \n\t"
+        "out    %[port],    %[lo]       \n\t"
+        "sbrc   %[bright],  1           \n\t"
+        "add    %[acc],     %[next]     \n\t"
+        "out    %[port],    %[hi]       \n\t"
+        "mov    %[n2],      %[lo]       \n\t"
+        "out    %[port],    %[n1]       \n\t"
+        "ror    %[acc]                  \n\t"
+        "clc                             \n\t"
+        "sbrc   %[byte],    4           \n\t"
+        "mov    %[n2],      %[hi]       \n\t"
+        "out    %[port],    %[lo]       \n\t"
+        "sbrc   %[bright],  2           \n\t"
+        "add    %[acc],     %[next]     \n\t"
+        "out    %[port],    %[hi]       \n\t"
+        "mov    %[n1],      %[lo]       \n\t"
+        "out    %[port],    %[n2]       \n\t"
+        "ror    %[acc]                  \n\t"
+        "clc                             \n\t"
+        "sbrc   %[byte],    3           \n\t"
+        "mov    %[n1],      %[hi]       \n\t"
+        "out    %[port],    %[lo]       \n\t"
+        "sbrc   %[bright],  3           \n\t"
+        "add    %[acc],     %[next]     \n\t"
+        "out    %[port],    %[hi]       \n\t"
+        "mov    %[n2],      %[lo]       \n\t"
+        "out    %[port],    %[n1]       \n\t"
+        "ror    %[acc]                  \n\t"
+        "clc                             \n\t"
+        "sbrc   %[byte],    2           \n\t"
+        "mov    %[n2],      %[hi]       \n\t"
+        "out    %[port],    %[lo]       \n\t"
+        "sbrc   %[bright],  4           \n\t"
+        "add    %[acc],     %[next]     \n\t"
+        "out    %[port],    %[hi]       \n\t"
+        "mov    %[n1],      %[lo]       \n\t"
+        "out    %[port],    %[n2]       \n\t"
+        "ror    %[acc]                  \n\t"
+        "clc                             \n\t"
+        "sbrc   %[byte],    1           \n\t"
+        "mov    %[n1],      %[hi]       \n\t"
+        "out    %[port],    %[lo]       \n\t"
+        "sbrc   %[bright],  5           \n\t"
+        "add    %[acc],     %[next]     \n\t"
+        "out    %[port],    %[hi]       \n\t"
+        "mov    %[n2],      %[lo]       \n\t"
+        "out    %[port],    %[n1]       \n\t"
+        "ror    %[acc]                  \n\t"
+        "clc                             \n\t"
+        "sbrc   %[byte],    0           \n\t"
+        "mov    %[n2],      %[hi]       \n\t"
+        "out    %[port],    %[lo]       \n\t"
+        "sbrc   %[bright],  6           \n\t"
+        "add    %[acc],     %[next]     \n\t"
+        "out    %[port],    %[hi]       \n\t"
+        "mov    %[n1],      %[lo]       \n\t"
+        "out    %[port],    %[n2]       \n\t"
+        "ror    %[acc]                  \n\t"
+        "clc                             \n\t"
+        "sbrc   %[bright],  7           \n\t"
+        "add    %[acc],     %[next]     \n\t"
+        "out    %[port],    %[lo]       \n\t"
+        "ror    %[acc]                  \n\t"
+        "mov    %[byte],    %[acc]      \n\t"
+        "ld     %[next],    %a[ptr]+    \n\t"
+        "sbrc   %[byte],    7           \n\t"
+        "mov    %[n1],      %[hi]       \n\t"
+        "sbiw   %[count],   1           \n\t"
+        "brne   headS%=                   \n"
+        /* Read-write variables */
+        : [byte]   "+r" (b),
+          [next]   "+r" (next),
+          [acc]    "+r" (acc),
+          [n1]     "+r" (n1),
+          [n2]     "+r" (n2),
+          [count]  "+w" (num_bytes),
+          [ptr]    "+e" (ptr)
+        /* Read-only variables */
+        : [port]   "I"  (_SFR_IO_ADDR(PORTB)),
+          [bright] "r"  (brightness),
+          [hi]     "r"  (hi),
+          [lo]     "r"  (lo));
+}
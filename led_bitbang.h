@@ -3,3 +3,4 @@
  */
 
 void led_show(uint8_t *data);
+void led_show_scaled(uint8_t *data, uint8_t brightness);
@@ -0,0 +1,148 @@
+/*
+ * Fast pseudo-random numbers and 8-bit value noise for procedural modes.
+ *
+ * The permutation table is Ken Perlin's, from the reference implementation
+ * of improved noise. Here it also serves as the random value at each
+ * lattice point.
+ */
+
+#include <stdint.h>
+
+#include <avr/eeprom.h>
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+
+#include "noise.h"
+#include "scale8.h"
+
+static uint16_t random_state = 0xace1;
+
+static const uint8_t noise_perm [256] PROGMEM = {
+    0x97, 0xa0, 0x89, 0x5b, 0x5a, 0x0f, 0x83, 0x0d, 0xc9, 0x5f, 0x60, 0x35, 0xc2, 0xe9, 0x07, 0xe1,
+    0x8c, 0x24, 0x67, 0x1e, 0x45, 0x8e, 0x08, 0x63, 0x25, 0xf0, 0x15, 0x0a, 0x17, 0xbe, 0x06, 0x94,
+    0xf7, 0x78, 0xea, 0x4b, 0x00, 0x1a, 0xc5, 0x3e, 0x5e, 0xfc, 0xdb, 0xcb, 0x75, 0x23, 0x0b, 0x20,
+    0x39, 0xb1, 0x21, 0x58, 0xed, 0x95, 0x38, 0x57, 0xae, 0x14, 0x7d, 0x88, 0xab, 0xa8, 0x44, 0xaf,
+    0x4a, 0xa5, 0x47, 0x86, 0x8b, 0x30, 0x1b, 0xa6, 0x4d, 0x92, 0x9e, 0xe7, 0x53, 0x6f, 0xe5, 0x7a,
+    0x3c, 0xd3, 0x85, 0xe6, 0xdc, 0x69, 0x5c, 0x29, 0x37, 0x2e, 0xf5, 0x28, 0xf4, 0x66, 0x8f, 0x36,
+    0x41, 0x19, 0x3f, 0xa1, 0x01, 0xd8, 0x50, 0x49, 0xd1, 0x4c, 0x84, 0xbb, 0xd0, 0x59, 0x12, 0xa9,
+    0xc8, 0xc4, 0x87, 0x82, 0x74, 0xbc, 0x9f, 0x56, 0xa4, 0x64, 0x6d, 0xc6, 0xad, 0xba, 0x03, 0x40,
+    0x34, 0xd9, 0xe2, 0xfa, 0x7c, 0x7b, 0x05, 0xca, 0x26, 0x93, 0x76, 0x7e, 0xff, 0x52, 0x55, 0xd4,
+    0xcf, 0xce, 0x3b, 0xe3, 0x2f, 0x10, 0x3a, 0x11, 0xb6, 0xbd, 0x1c, 0x2a, 0xdf, 0xb7, 0xaa, 0xd5,
+    0x77, 0xf8, 0x98, 0x02, 0x2c, 0x9a, 0xa3, 0x46, 0xdd, 0x99, 0x65, 0x9b, 0xa7, 0x2b, 0xac, 0x09,
+    0x81, 0x16, 0x27, 0xfd, 0x13, 0x62, 0x6c, 0x6e, 0x4f, 0x71, 0xe0, 0xe8, 0xb2, 0xb9, 0x70, 0x68,
+    0xda, 0xf6, 0x61, 0xe4, 0xfb, 0x22, 0xf2, 0xc1, 0xee, 0xd2, 0x90, 0x0c, 0xbf, 0xb3, 0xa2, 0xf1,
+    0x51, 0x33, 0x91, 0xeb, 0xf9, 0x0e, 0xef, 0x6b, 0x31, 0xc0, 0xd6, 0x1f, 0xb5, 0xc7, 0x6a, 0x9d,
+    0xb8, 0x54, 0xcc, 0xb0, 0x73, 0x79, 0x32, 0x2d, 0x7f, 0x04, 0x96, 0xfe, 0x8a, 0xec, 0xcd, 0x5d,
+    0xde, 0x72, 0x43, 0x1d, 0x18, 0x48, 0xf3, 0x8d, 0x80, 0xc3, 0x4e, 0x42, 0xd7, 0x3d, 0x9c, 0xb4
+};
+
+/*
+ * Mix some entropy, such as the timing of a boop, into the generator.
+ */
+void random_stir (uint8_t entropy)
+{
+    random_state ^= entropy;
+
+    /* The all-zero state never leaves zero */
+    if (random_state == 0)
+    {
+        random_state = 0xace1;
+    }
+}
+
+/*
+ * 16-bit xorshift (7, 9, 8), returning the high byte.
+ */
+uint8_t random8 (void)
+{
+    random_state ^= random_state << 7;
+    random_state ^= random_state >> 9;
+    random_state ^= random_state << 8;
+
+    return random_state >> 8;
+}
+
+/*
+ * One-dimensional value noise. x is 8.8 fixed-point, with a new random
+ * value at each whole number and a smooth blend between them.
+ */
+uint8_t noise8 (uint16_t x)
+{
+    uint8_t i = x >> 8;
+    uint8_t t = x & 0xff;
+    uint8_t a = pgm_read_byte (&noise_perm [i]);
+    uint8_t b = pgm_read_byte (&noise_perm [(uint8_t) (i + 1)]);
+
+    /* Ease the fraction with 3t^2 - 2t^3 */
+    t = ((uint16_t) scale8 (t, t) * (uint16_t) (0x2ff - 2 * t)) >> 8;
+
+    if (b > a)
+    {
+        return a + scale8 (b - a, t);
+    }
+    else
+    {
+        return a - scale8 (a - b, t);
+    }
+}
+
+#ifdef NOISE_BENCHMARK
+
+#define NOISE_BENCHMARK_CALLS 8
+
+static volatile uint8_t noise_sink;
+
+/*
+ * Time NOISE_BENCHMARK_CALLS calls with Timer0 at clk/64, returning the
+ * cycles per call. Routine 0 is an empty loop, to subtract.
+ */
+static uint16_t noise_time (uint8_t routine)
+{
+    uint8_t i;
+
+    TCNT0 = 0;
+    TIFR = (1 << TOV0);
+    TCCR0B = 0x03;
+
+    for (i = 0; i < NOISE_BENCHMARK_CALLS; i++)
+    {
+        noise_sink = (routine == 0) ? i :
+                     (routine == 1) ? random8 () :
+                                      noise8 (i * 0x1357);
+    }
+
+    TCCR0B = 0x00;
+
+    /* The 8-bit count only holds 255 * 64 cycles */
+    if (TIFR & (1 << TOV0))
+    {
+        return NOISE_BENCHMARK_OVERFLOW;
+    }
+
+    return TCNT0 * 64 / NOISE_BENCHMARK_CALLS;
+}
+
+/*
+ * Measure random8 () and noise8 () on the chip, before Timer0 is needed
+ * for the tick, and save the cycles per call to EEPROM.
+ */
+void noise_benchmark (void)
+{
+    uint16_t empty = noise_time (0);
+    uint16_t cycles;
+    uint8_t routine;
+
+    for (routine = 1; routine <= 2; routine++)
+    {
+        cycles = noise_time (routine);
+
+        if (cycles != NOISE_BENCHMARK_OVERFLOW)
+        {
+            cycles -= empty;
+        }
+
+        eeprom_update_word ((uint16_t *) NOISE_EEPROM_ADDRESS + routine - 1, cycles);
+    }
+}
+
+#endif
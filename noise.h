@@ -0,0 +1,18 @@
+/*
+ * Fast pseudo-random numbers and 8-bit value noise for procedural modes.
+ *
+ * The cost per call is measured on the chip by building with
+ * "NOISE_BENCHMARK=1 ./build.sh" and reading the result back with
+ * "./build.sh cycles", to within 8 cycles. Calls of over 2040 cycles are
+ * recorded as NOISE_BENCHMARK_OVERFLOW. The tiny45 has no hardware
+ * multiply, and noise8 () makes three 16-bit multiplies in software. One
+ * 20 ms tick is 160,000 cycles.
+ */
+
+#define NOISE_EEPROM_ADDRESS        (E2END - 5) /* random8 () then noise8 (), in cycles */
+#define NOISE_BENCHMARK_OVERFLOW    0xffff
+
+void random_stir (uint8_t entropy);
+uint8_t random8 (void);
+uint8_t noise8 (uint16_t x);
+void noise_benchmark (void);
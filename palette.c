@@ -0,0 +1,86 @@
+/*
+ * Mode parameters, loaded from EEPROM at boot and cached in RAM.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <avr/eeprom.h>
+#include <avr/pgmspace.h>
+
+#include "rgb.h"
+#include "hsv2rgb.h"
+#include "palette.h"
+
+const Palette_t palette_defaults [MODE_COUNT] PROGMEM = {
+    /* Hue                Swing Val   Period  Boop hue          Boop sound */
+    { HUE_VIOLET,         32,   0x10, 64,     0,                BOOP_SOUND_TURNS }, /* Purple & Pink */
+    { HUE_ORANGE - 0x10,  32,   0x10, 64,     HUE_ORANGE,       BOOP_SOUND_TURNS }, /* Orange */
+    { HUE_RED - 0x10,     32,   0x10, 64,     HUE_RED,          BOOP_SOUND_TURNS }, /* Red */
+    { HUE_GREEN - 0x10,   32,   0x10, 64,     HUE_GREEN,        BOOP_SOUND_TURNS }, /* Green */
+    { HUE_AQUA - 0x10,    32,   0x10, 64,     HUE_AQUA + 0x10,  BOOP_SOUND_TURNS }, /* Blue */
+    { 0,                  2,    0x10, 128,    0,                BOOP_SOUND_TURNS }, /* Rainbow */
+    { 0,                  2,    0x10, 128,    0,                BOOP_SOUND_TURNS }, /* Rainbow-crossed */
+    { HUE_RED,            HUE_BLUE - HUE_RED,
+                                0x08, 16,     0,                BOOP_SOUND_SIREN }, /* Pirihimana */
+    { HUE_RED,            32,   0x06, 128,    HUE_ORANGE,       BOOP_SOUND_TURNS }, /* Fire */
+    { HUE_AQUA,           32,   0x04, 128,    0,                BOOP_SOUND_TURNS }  /* Starlight */
+};
+
+Palette_t palette [MODE_COUNT];
+
+/*
+ * Sum of the bytes of a full set of parameters.
+ */
+uint8_t palette_checksum (const Palette_t *params)
+{
+    const uint8_t *bytes = (const uint8_t *) params;
+    uint8_t sum = 0;
+
+    for (uint8_t i = 0; i < sizeof (Palette_t) * MODE_COUNT; i++)
+    {
+        sum += bytes [i];
+    }
+
+    return sum;
+}
+
+/*
+ * Check the loaded parameters for values the patterns cannot handle.
+ */
+static bool palette_valid (void)
+{
+    for (uint8_t i = 0; i < MODE_COUNT; i++)
+    {
+        if (palette [i].val > PALETTE_VAL_MAX ||
+            palette [i].period < PALETTE_PERIOD_MIN || palette [i].period > PALETTE_PERIOD_MAX)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*
+ * Load the parameters from EEPROM, falling back to the defaults.
+ */
+void palette_load (void)
+{
+    PaletteHeader_t header;
+
+    eeprom_read_block (&header, (const void *) PALETTE_EEPROM_ADDRESS, sizeof (header));
+
+    if (header.magic == PALETTE_MAGIC && header.version == PALETTE_VERSION && header.modes == MODE_COUNT)
+    {
+        eeprom_read_block (palette, (const void *) (PALETTE_EEPROM_ADDRESS + sizeof (header)), sizeof (palette));
+
+        if (palette_checksum (palette) == header.checksum && palette_valid ())
+        {
+            return;
+        }
+    }
+
+    memcpy_P (palette, palette_defaults, sizeof (palette));
+}
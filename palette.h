@@ -0,0 +1,52 @@
+/*
+ * Mode parameters, loaded from EEPROM at boot and cached in RAM.
+ *
+ * The EEPROM block is a PaletteHeader_t followed by one Palette_t per mode.
+ * If the block is missing, from another version, fails its checksum, or
+ * has a val or period out of range, the defaults built into the firmware
+ * are used instead.
+ */
+
+#define MODE_COUNT 10
+
+#define PALETTE_EEPROM_ADDRESS  0x00
+#define PALETTE_MAGIC           0x46 /* 'F' */
+#define PALETTE_VERSION         1
+
+/* Boop sound choices */
+#define BOOP_SOUND_TURNS        0xff /* Take turns between the boop sounds */
+#define BOOP_SOUND_SIREN        3    /* 0-2 are the boop sounds themselves */
+#define BOOP_SOUND_COUNT        4
+
+/* Pattern periods, in frames. Shorter would divide by zero. */
+#define PALETTE_PERIOD_MIN      2
+#define PALETTE_PERIOD_MAX      128
+
+/* Brightest val. Fire adds up to 18 to it for flicker, and brighter would wrap to dark. */
+#define PALETTE_VAL_MAX         0xed
+
+typedef struct PaletteHeader_s {
+    uint8_t magic;
+    uint8_t version;
+    uint8_t modes;      /* MODE_COUNT */
+    uint8_t checksum;   /* Sum of the Palette_t bytes */
+} PaletteHeader_t;
+
+/*
+ * Not every mode uses every parameter. The rainbows (5, 6) always cycle
+ * over 256 frames and Fire (8) follows its noise, so they ignore period.
+ */
+typedef struct Palette_s {
+    uint8_t hue;        /* Base hue of the mode's pattern */
+    uint8_t swing;      /* Hue range, or hue step per frame for the rainbows */
+    uint8_t val;        /* Brightness of the mode's pattern */
+    uint8_t period;     /* Frames per cycle of the mode's pattern */
+    uint8_t boop_hue;   /* Base hue of the boop clip */
+    uint8_t boop_sound; /* BOOP_SOUND_TURNS, or a fixed choice */
+} Palette_t;
+
+extern const Palette_t palette_defaults [MODE_COUNT];
+extern Palette_t palette [MODE_COUNT];
+
+uint8_t palette_checksum (const Palette_t *params);
+void palette_load (void);
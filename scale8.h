@@ -0,0 +1,9 @@
+/*
+ * Scale one 8-bit value by another, treating scale as a fraction of 256.
+ * Shared by the colour and noise code. Include only from .c files.
+ */
+
+static inline uint8_t scale8 (uint8_t i, uint8_t scale)
+{
+    return ((uint16_t) i * (1 + scale)) >> 8;
+}
@@ -0,0 +1,67 @@
+/*
+ * Stack high-water mark measurement.
+ */
+
+#ifdef STACK_PAINT
+
+#include <stdint.h>
+
+#include <avr/eeprom.h>
+#include <avr/io.h>
+
+#include "stack.h"
+
+/* From the linker: the end of .data and .bss, and the top of RAM */
+extern uint8_t _end;
+extern uint8_t __stack;
+
+/*
+ * Paint everything from the end of .bss to the top of RAM. This runs in
+ * .init1, before the stack pointer is set up, so can only use registers.
+ */
+void stack_paint (void) __attribute__ ((naked, used, section (".init1")));
+void stack_paint (void)
+{
+    asm volatile (
+        "ldi    r30,    lo8(_end)       \n\t"
+        "ldi    r31,    hi8(_end)       \n\t"
+        "ldi    r24,    %[paint]        \n\t"
+        "ldi    r25,    hi8(__stack)    \n\t"
+        "rjmp   2f                      \n"
+        "1:                             \n\t"
+        "st     Z+,     r24             \n"
+        "2:                             \n\t"
+        "cpi    r30,    lo8(__stack)    \n\t"
+        "cpc    r31,    r25             \n\t"
+        "brlo   1b                      \n\t"
+        "breq   1b                      \n"
+        :
+        : [paint] "M" (STACK_PAINT_BYTE));
+}
+
+/*
+ * Bytes of free RAM that the stack has never reached.
+ */
+uint16_t stack_headroom (void)
+{
+    const uint8_t *p = &_end;
+    uint16_t count = 0;
+
+    while (p <= &__stack && *p == STACK_PAINT_BYTE)
+    {
+        p++;
+        count++;
+    }
+
+    return count;
+}
+
+/*
+ * Save the headroom to EEPROM. Only changes are written, to spare the EEPROM.
+ */
+void stack_report (void)
+{
+    eeprom_update_word ((uint16_t *) STACK_EEPROM_ADDRESS, stack_headroom ());
+}
+
+#endif
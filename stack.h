@@ -0,0 +1,13 @@
+/*
+ * Stack high-water mark measurement, enabled by building with STACK_PAINT.
+ *
+ * Free RAM is painted at startup, and the unpainted part found later is as
+ * deep as the stack has ever reached. The headroom that was never touched
+ * is saved to the end of EEPROM, read with "./build.sh stack".
+ */
+
+#define STACK_PAINT_BYTE        0xc5
+#define STACK_EEPROM_ADDRESS    (E2END - 1)
+
+uint16_t stack_headroom (void);
+void stack_report (void);
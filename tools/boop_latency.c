@@ -0,0 +1,110 @@
+/*
+ * Furbadge boop latency harness
+ *
+ * Runs the firmware against a simulated boop sensor and reports the time
+ * from a boop starting to the first frame of the boop effect reaching the
+ * LEDs, and how many boops of a rapid burst are seen.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define main badge_main
+#include "badge.c"
+#undef main
+
+#include "host.h"
+
+#define TICK_US     20000
+#define TRIALS      1000
+
+static uint32_t press_start_us = 0;
+static uint32_t press_end_us = 0;
+static uint32_t burst_start_us = UINT32_MAX;
+
+static uint16_t boop_model (void)
+{
+    if (host_time_us >= press_start_us && host_time_us < press_end_us)
+    {
+        return 400;
+    }
+
+    if (host_time_us >= burst_start_us && host_time_us < burst_start_us + 2000000 &&
+        (host_time_us - burst_start_us) % 200000 < 100000)
+    {
+        return 400;
+    }
+
+    return 100;
+}
+
+/*
+ * Run one tick, returning true if it showed the first frame of a boop.
+ */
+static bool run_tick (uint32_t tick)
+{
+    host_time_us = tick * TICK_US;
+    TIMER0_COMPA_vect ();
+
+    return timeline_lights != NULL && timeline_frame == 1;
+}
+
+int main (void)
+{
+    uint32_t tick = 0;
+    uint32_t latency_min = UINT32_MAX;
+    uint32_t latency_max = 0;
+    uint64_t latency_sum = 0;
+    uint32_t missed = 0;
+    uint32_t rapid_seen = 0;
+
+    srand (1);
+    host_boop_model = boop_model;
+    palette_load ();
+    boop_calibrate ();
+
+    for (int i = 0; i < TRIALS; i++)
+    {
+        bool seen = false;
+
+        /* A 200 ms boop, starting at a random point in the tick */
+        tick += 100;
+        press_start_us = tick * TICK_US + rand () % TICK_US;
+        press_end_us = press_start_us + 200000;
+
+        for (uint32_t end = tick + 100; tick < end; tick++)
+        {
+            if (run_tick (tick) && !seen && host_led_time_us >= press_start_us)
+            {
+                uint32_t latency = host_led_time_us - press_start_us;
+
+                seen = true;
+                latency_sum += latency;
+                latency_min = (latency < latency_min) ? latency : latency_min;
+                latency_max = (latency > latency_max) ? latency : latency_max;
+            }
+        }
+
+        if (!seen)
+        {
+            missed++;
+        }
+    }
+
+    /* Ten 100 ms boops with 100 ms between them */
+    tick += 100;
+    burst_start_us = tick * TICK_US;
+    for (uint32_t end = tick + 200; tick < end; tick++)
+    {
+        if (run_tick (tick))
+        {
+            rapid_seen++;
+        }
+    }
+
+    printf ("Boop-to-light latency over %d boops: min %.1f ms, mean %.1f ms, max %.1f ms, missed %u\n",
+            TRIALS, latency_min / 1000.0, latency_sum / 1000.0 / (TRIALS - missed), latency_max / 1000.0, missed);
+    printf ("Rapid boops (100 ms on, 100 ms off): %u of 10 seen\n", rapid_seen);
+
+    return missed ? 1 : 0;
+}
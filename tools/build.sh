@@ -0,0 +1,17 @@
+#!/bin/sh
+
+# Build the Furbadge host tools, running the firmware against simulated hardware.
+
+cd "$(dirname "$0")/.." || exit
+
+CC="${CC:-gcc}"
+CFLAGS="-g -O2 -Wall -Itools/host -I."
+FIRMWARE="battery.c boop.c hsv2rgb.c noise.c palette.c tools/host/host.c"
+
+mkdir -p tools/bin
+
+${CC} ${CFLAGS} tools/boop_latency.c ${FIRMWARE} -o tools/bin/boop_latency || exit
+${CC} ${CFLAGS} tools/standby_power.c ${FIRMWARE} -o tools/bin/standby_power || exit
+${CC} ${CFLAGS} tools/palette_image.c palette.c tools/host/host.c -o tools/bin/palette_image || exit
+${CC} ${CFLAGS} tools/fleet_sim.c ${FIRMWARE} -o tools/bin/fleet_sim || exit
+${CC} ${CFLAGS} tools/ws2812_timing.c -o tools/bin/ws2812_timing || exit
@@ -0,0 +1,488 @@
+/*
+ * Furbadge fleet simulation
+ *
+ * Runs many independent badges against randomised handling, checking the
+ * firmware's state after every tick. Each badge is a forked copy of this
+ * process, so starts from fresh firmware state, and badges are run in
+ * parallel across all cores.
+ *
+ * Usage: fleet_sim [badges] [hours per badge] [jobs] [first badge]
+ *
+ * A failing badge reports its number, which sets its random seed, so it
+ * can be re-run alone with its first failure repeated, as badge N with
+ * "fleet_sim 1 [hours per badge] 1 N".
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define main badge_main
+#include "badge.c"
+#undef main
+
+#include "host.h"
+
+#define TICK_US             20000
+#define MINUTE_US           60000000UL
+
+/* A boop needs to be sampled before it can be shown */
+#define BOOP_SEEN_US        40000   /* Press length that is always sampled */
+#define BOOP_SHOWN_US       40000   /* From press to the boop being shown */
+
+/* Standby may only start after a long-hold, or when idle */
+#define LONG_HOLD_US        (GESTURE_LONG_HOLD_SAMPLES * TICK_US)
+#define STANDBY_TIMEOUT_US  (STANDBY_TIMEOUT_TICKS * (uint64_t) TICK_US)
+
+/* Long enough for a handful of boops, and short of the 32-bit clock wrapping */
+#define STANDBY_STUCK_US    (60 * MINUTE_US)
+
+typedef struct Track_s {
+    const Cue_t *cues;
+    uint8_t length;
+} Track_t;
+
+#define TRACK(cues) { cues, sizeof (cues) / sizeof (cues [0]) }
+
+static const Track_t sound_tracks [] = {
+    TRACK (sound_mode_change),
+    TRACK (sound_low_battery),
+    TRACK (sound_boop_siren),
+    TRACK (sound_boop_0),
+    TRACK (sound_boop_1),
+    TRACK (sound_boop_2)
+};
+
+static const Track_t light_tracks [] = {
+    TRACK (lights_low_battery),
+    TRACK (lights_boop_flicker),
+    TRACK (lights_boop_strobe),
+    TRACK (lights_boop_rainbow),
+    TRACK (lights_boop_siren),
+    TRACK (lights_boop_flare),
+    TRACK (lights_boop_sparkle)
+};
+
+#define TRACK_COUNT(tracks) (sizeof (tracks) / sizeof (tracks [0]))
+
+/* Sent from each badge back to the parent */
+typedef struct Report_s {
+    uint64_t simulated_us;
+    uint32_t presses;
+    uint32_t standbys;
+    bool failed;
+    char failure [96];
+} Report_t;
+
+/* Handling model */
+static bool model_pressed = false;
+static uint32_t model_phase_start_us = 0;
+static uint32_t model_phase_end_us = 0;
+static uint32_t model_boop_us = 0;      /* Start of the last press long enough to be seen */
+static uint32_t model_boop_length_us = 0;
+static bool model_in_standby = false;
+static uint32_t model_standby_us = 0;   /* When standby started */
+static bool boop_due = false;
+static uint32_t boop_due_us = 0;
+
+static Report_t report;
+static int report_fd;
+
+static void fail (const char *failure);
+static void report_send (void);
+
+static uint32_t random_range (uint32_t min, uint32_t max)
+{
+    return min + (uint32_t) rand () % (max - min + 1);
+}
+
+/*
+ * Choose how long the next press or gap lasts. Gaps are occasionally
+ * chosen to end right around the standby timeout.
+ */
+static void model_next_phase (void)
+{
+    uint32_t length_ms;
+    uint32_t r = rand () % 100;
+
+    model_pressed = !model_pressed;
+    model_phase_start_us = model_phase_end_us;
+
+    if (model_pressed)
+    {
+        length_ms = (r <  5) ? random_range (   5,   30) :     /* Glitch */
+                    (r < 65) ? random_range (  30,  400) :     /* Boop */
+                    (r < 90) ? random_range ( 700, 4900) :     /* Hold, with repeats */
+                               random_range (5100, 7000);      /* Long-hold */
+        report.presses++;
+
+        /* The firmware counts idle time from the start of a boop, and glitches may pass unseen */
+        if (length_ms * 1000 >= BOOP_SEEN_US)
+        {
+            model_boop_us = model_phase_start_us;
+            model_boop_length_us = length_ms * 1000;
+        }
+
+        if (length_ms * 1000 >= BOOP_SEEN_US && !model_in_standby)
+        {
+            boop_due = true;
+            boop_due_us = model_phase_start_us + BOOP_SHOWN_US;
+        }
+    }
+    else
+    {
+        length_ms = (r < 60) ? random_range (   100,   1000) :
+                    (r < 85) ? random_range (  1000,  20000) :
+                    (r < 95) ? random_range ( 20000, 120000) :
+                    (r < 98) ? random_range (300000, 900000) :
+                               random_range (STANDBY_TIMEOUT_US / 1000 - 1000, STANDBY_TIMEOUT_US / 1000 + 1000);
+    }
+
+    model_phase_end_us = model_phase_start_us + length_ms * 1000;
+}
+
+static uint16_t boop_model (void)
+{
+    /* A badge that never wakes would otherwise hold up its job forever */
+    if (model_in_standby && host_time_us - model_standby_us > STANDBY_STUCK_US)
+    {
+        report.simulated_us += host_time_us - model_standby_us;
+        fail ("never woke from standby");
+        report_send ();
+    }
+
+    while ((int32_t) (host_time_us - model_phase_end_us) >= 0)
+    {
+        model_next_phase ();
+    }
+
+    return model_pressed ? 400 : 100;
+}
+
+/*
+ * Find the track a cue pointer is inside, if any.
+ */
+static const Track_t *track_find (const Cue_t *cue, const Track_t *tracks, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        if (cue >= tracks [i].cues && cue < tracks [i].cues + tracks [i].length)
+        {
+            return &tracks [i];
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * Check that a cue pointer is inside one of the tracks, on a cue of the expected type.
+ */
+static bool cue_valid (const Cue_t *cue, const Track_t *tracks, int count, uint8_t type)
+{
+    if (track_find (cue, tracks, count) == NULL)
+    {
+        return false;
+    }
+
+    return cue->type == type || cue->type == CUE_END;
+}
+
+/*
+ * Check the firmware state after a tick, returning a description of the first problem found.
+ */
+static const char *check_tick (void)
+{
+    bool piezo_on = (GTCCR & ((1 << COM1B1) | (1 << COM1B0))) != 0;
+
+    if (mode >= MODE_COUNT)
+    {
+        return "mode out of range";
+    }
+
+    if (timeline_sound != NULL && !cue_valid (timeline_sound, sound_tracks, TRACK_COUNT (sound_tracks), CUE_TONE))
+    {
+        return "sound cue outside of the sound tracks";
+    }
+
+    if (timeline_lights != NULL && !cue_valid (timeline_lights, light_tracks, TRACK_COUNT (light_tracks), CUE_LIGHT))
+    {
+        return "light cue outside of the light tracks";
+    }
+
+    for (int eye = 0; eye < 2; eye++)
+    {
+        if (timeline_eyes [eye] != NULL &&
+            (!cue_valid (timeline_eyes [eye], light_tracks, TRACK_COUNT (light_tracks), CUE_LIGHT) ||
+             timeline_eyes [eye]->type != CUE_LIGHT))
+        {
+            return "eye showing something other than a light cue";
+        }
+    }
+
+    if (piezo_on && timeline_sound == NULL)
+    {
+        return "piezo left on after the sound track ended";
+    }
+
+    if (piezo_on && (timeline_freq <= 31250 / 256 || timeline_freq > 31250))
+    {
+        return "tone frequency out of the timer's range";
+    }
+
+    if (idle_ticks > STANDBY_TIMEOUT_TICKS)
+    {
+        return "idle counter ran past the standby timeout";
+    }
+
+    if (brightness < BATTERY_DIM_MIN)
+    {
+        return "brightness below the low-battery minimum";
+    }
+
+    /* A boop that has shown its first frame, or a low-battery warning that replaced it in the same tick */
+    if ((timeline_frame == 1 && timeline_lights != NULL &&
+         track_find (timeline_lights, light_tracks, TRACK_COUNT (light_tracks))->cues == pgm_read_ptr (&mode_boop_lights [mode])) ||
+        (timeline_frame == 0 && timeline_lights == lights_low_battery))
+    {
+        boop_due = false;
+    }
+
+    if (boop_due && (int32_t) (host_time_us - boop_due_us) > 0)
+    {
+        return "boop not shown, boop state stuck";
+    }
+
+    return NULL;
+}
+
+/*
+ * Check that standby was asked for by a long-hold or by the idle timeout.
+ */
+static const char *check_standby (void)
+{
+    uint32_t since_us = host_time_us - model_boop_us;
+
+    if (since_us >= STANDBY_TIMEOUT_US - 2 * TICK_US)
+    {
+        return NULL;
+    }
+
+    if (model_boop_length_us >= LONG_HOLD_US - 2 * TICK_US && since_us >= LONG_HOLD_US - 2 * TICK_US)
+    {
+        return NULL;
+    }
+
+    return "standby without a long-hold or the idle timeout";
+}
+
+/*
+ * Send the report to the parent, ending this badge.
+ */
+static void report_send (void)
+{
+    if (write (report_fd, &report, sizeof (report)) != sizeof (report))
+    {
+        _exit (1);
+    }
+    _exit (0);
+}
+
+static void fail (const char *failure)
+{
+    report.failed = true;
+    snprintf (report.failure, sizeof (report.failure), "%.1f minutes in, %s",
+              report.simulated_us / (double) MINUTE_US, failure);
+}
+
+/*
+ * Run one badge, from power-on.
+ */
+static void badge_run (uint32_t seed, uint64_t run_us)
+{
+    uint32_t tick_us;
+    uint32_t minute_us = 0;
+    const char *failure;
+
+    /* glibc treats seeds 0 and 1 alike, which would make badges 0 and 1 twins */
+    srand (seed + 1);
+    host_boop_model = boop_model;
+    host_vcc_mv = random_range (3100, 4200);
+
+    /* Left alone while calibrating */
+    model_phase_end_us = host_time_us + 1000000;
+    model_boop_us = host_time_us;
+
+    palette_load ();
+    boop_calibrate ();
+    tick_us = host_time_us;
+
+    while (report.simulated_us < run_us)
+    {
+        host_time_us = tick_us;
+        TIMER0_COMPA_vect ();
+        tick_us += TICK_US;
+        report.simulated_us += TICK_US;
+        minute_us += TICK_US;
+
+        if ((failure = check_tick ()) != NULL)
+        {
+            fail (failure);
+            return;
+        }
+
+        if (standby_request)
+        {
+            if ((failure = check_standby ()) != NULL)
+            {
+                fail (failure);
+                return;
+            }
+
+            model_standby_us = host_time_us;
+            model_in_standby = true;
+            standby ();
+            model_in_standby = false;
+            report.standbys++;
+
+            report.simulated_us += host_time_us - model_standby_us;
+            tick_us = host_time_us;
+        }
+
+        /* The battery wanders, crossing the dim and low thresholds */
+        if (minute_us >= MINUTE_US)
+        {
+            minute_us = 0;
+            host_vcc_mv += random_range (0, 200) - 100;
+            host_vcc_mv = (host_vcc_mv < 3000) ? 3000 : (host_vcc_mv > 4300) ? 4300 : host_vcc_mv;
+        }
+    }
+}
+
+static double wall_time (void)
+{
+    struct timeval now;
+
+    gettimeofday (&now, NULL);
+
+    return now.tv_sec + now.tv_usec / 1000000.0;
+}
+
+int main (int argc, char **argv)
+{
+    uint32_t badges = (argc > 1) ? strtoul (argv [1], NULL, 0) : 1000;
+    double hours = (argc > 2) ? strtod (argv [2], NULL) : 1.0;
+    uint32_t jobs = (argc > 3) ? strtoul (argv [3], NULL, 0) : (uint32_t) sysconf (_SC_NPROCESSORS_ONLN);
+    uint32_t first = (argc > 4) ? strtoul (argv [4], NULL, 0) : 0;
+    uint64_t run_us = hours * 3600 * 1000000;
+
+    pid_t *pids = calloc (jobs, sizeof (pid_t));
+    int *pipes = calloc (jobs, sizeof (int));
+    uint32_t *numbers = calloc (jobs, sizeof (uint32_t));
+    uint32_t started = 0;
+    uint32_t running = 0;
+    uint32_t failed = 0;
+    uint64_t simulated_us = 0;
+    uint64_t presses = 0;
+    uint64_t standbys = 0;
+    double start = wall_time ();
+    double elapsed;
+
+    /* Every track the firmware can play must be known to the checks */
+    for (int i = 0; i < MODE_COUNT; i++)
+    {
+        if (!cue_valid (mode_boop_lights [i], light_tracks, TRACK_COUNT (light_tracks), CUE_LIGHT))
+        {
+            printf ("Boop lights for mode %d are missing from light_tracks\n", i);
+            return 1;
+        }
+    }
+    for (int i = 0; i < BOOP_SOUND_COUNT; i++)
+    {
+        if (!cue_valid (boop_sounds [i], sound_tracks, TRACK_COUNT (sound_tracks), CUE_TONE))
+        {
+            printf ("Boop sound %d is missing from sound_tracks\n", i);
+            return 1;
+        }
+    }
+
+    while (started < badges || running > 0)
+    {
+        /* Keep every job busy */
+        for (uint32_t job = 0; job < jobs && started < badges; job++)
+        {
+            int fds [2];
+
+            if (pids [job] != 0)
+            {
+                continue;
+            }
+
+            if (pipe (fds) != 0 || (pids [job] = fork ()) < 0)
+            {
+                perror ("fleet_sim");
+                return 1;
+            }
+
+            if (pids [job] == 0)
+            {
+                close (fds [0]);
+                report_fd = fds [1];
+                badge_run (first + started, run_us);
+                report_send ();
+            }
+
+            close (fds [1]);
+            pipes [job] = fds [0];
+            numbers [job] = first + started++;
+            running++;
+        }
+
+        /* Collect a finished badge */
+        pid_t pid = wait (NULL);
+
+        for (uint32_t job = 0; job < jobs; job++)
+        {
+            Report_t result;
+
+            if (pids [job] != pid)
+            {
+                continue;
+            }
+
+            if (read (pipes [job], &result, sizeof (result)) != sizeof (result))
+            {
+                result.failed = true;
+                snprintf (result.failure, sizeof (result.failure), "crashed");
+            }
+
+            if (result.failed)
+            {
+                printf ("Badge %u: %s\n", numbers [job], result.failure);
+                failed++;
+            }
+            else
+            {
+                simulated_us += result.simulated_us;
+                presses += result.presses;
+                standbys += result.standbys;
+            }
+
+            close (pipes [job]);
+            pids [job] = 0;
+            running--;
+        }
+    }
+
+    elapsed = wall_time () - start;
+
+    printf ("%u badges, %u failed, %.1f badge-hours simulated over %u jobs in %.1f s\n",
+            badges, failed, simulated_us / 3600e6, jobs, elapsed);
+    printf ("%" PRIu64 " presses, %" PRIu64 " standbys, %.1f simulated badge-hours per second\n",
+            presses, standbys, simulated_us / 3600e6 / elapsed);
+
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,13 @@
+/*
+ * Host stand-in for <avr/eeprom.h>. EEPROM is an array, erased to 0xff.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define HOST_EEPROM_SIZE 256
+
+extern uint8_t host_eeprom [HOST_EEPROM_SIZE];
+
+void eeprom_read_block (void *dst, const void *src, size_t n);
+void eeprom_update_word (uint16_t *dst, uint16_t value);
@@ -0,0 +1,8 @@
+/*
+ * Host stand-in for <avr/interrupt.h>. The tools call vectors directly.
+ */
+
+#define ISR(vector) void vector (void)
+#define sei()
+#define cli()
+#define EMPTY_INTERRUPT(vector) void vector (void) { }
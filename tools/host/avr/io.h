@@ -0,0 +1,54 @@
+/*
+ * Host stand-in for <avr/io.h>. Registers are plain variables.
+ */
+
+#include <stdint.h>
+
+extern volatile uint8_t PORTB;
+extern volatile uint8_t DDRB;
+extern volatile uint8_t ACSR;
+extern volatile uint8_t ADCSRA;
+extern volatile uint8_t ADMUX;
+extern volatile uint8_t GTCCR;
+extern volatile uint8_t OCR0A;
+extern volatile uint8_t OCR1B;
+extern volatile uint8_t OCR1C;
+extern volatile uint8_t TCCR0A;
+extern volatile uint8_t TCCR0B;
+extern volatile uint8_t TCCR1;
+extern volatile uint8_t TCNT0;
+extern volatile uint8_t TIFR;
+extern volatile uint8_t TIMSK;
+extern volatile uint8_t WDTCR;
+
+/* Reading PINB runs the boop sensor model */
+uint8_t host_pinb (void);
+#define PINB host_pinb ()
+
+/* Reading the ADC measures the bandgap against the modelled supply */
+uint16_t host_adc (void);
+#define ADCW host_adc ()
+
+#define PB2 2
+
+#define DDB1 1
+#define DDB2 2
+#define DDB3 3
+#define DDB4 4
+
+#define COM1B0 4
+#define COM1B1 5
+
+#define ACD 7
+
+#define ADSC 6
+
+#define TOV0 1
+
+#define WDE  3
+#define WDCE 4
+#define WDIE 6
+
+#define E2END 0xff
+#define RAMSTART 0x60
+#define RAMEND 0x15f
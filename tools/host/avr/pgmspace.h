@@ -0,0 +1,12 @@
+/*
+ * Host stand-in for <avr/pgmspace.h>. Flash is ordinary memory.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#define PROGMEM
+#define pgm_read_byte(address) (*(const uint8_t *) (address))
+#define pgm_read_word(address) (*(const uint16_t *) (address))
+#define pgm_read_ptr(address) (*(const void * const *) (address))
+#define memcpy_P(dst, src, n) memcpy ((dst), (src), (n))
@@ -0,0 +1,12 @@
+/*
+ * Host stand-in for <avr/sleep.h>. Sleeping advances the simulated clock.
+ */
+
+void host_sleep (void);
+
+#define SLEEP_MODE_PWR_DOWN 2
+
+#define set_sleep_mode(mode)
+#define sleep_enable()
+#define sleep_disable()
+#define sleep_cpu() host_sleep ()
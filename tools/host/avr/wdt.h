@@ -0,0 +1,16 @@
+/*
+ * Host stand-in for <avr/wdt.h>.
+ */
+
+void host_wdt_reset (void);
+
+#define wdt_reset() host_wdt_reset ()
+
+#define WDTO_15MS   0
+#define WDTO_30MS   1
+#define WDTO_60MS   2
+#define WDTO_120MS  3
+#define WDTO_250MS  4
+#define WDTO_500MS  5
+#define WDTO_1S     6
+#define WDTO_2S     7
@@ -0,0 +1,144 @@
+/*
+ * Simulated hardware for running the badge firmware on a PC.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "host.h"
+#include "avr/eeprom.h"
+
+volatile uint8_t PORTB;
+volatile uint8_t DDRB;
+volatile uint8_t ACSR;
+volatile uint8_t ADCSRA;
+volatile uint8_t ADMUX;
+volatile uint8_t GTCCR;
+volatile uint8_t OCR0A;
+volatile uint8_t OCR1B;
+volatile uint8_t OCR1C;
+volatile uint8_t TCCR0A;
+volatile uint8_t TCCR0B;
+volatile uint8_t TCCR1;
+volatile uint8_t TCNT0;
+volatile uint8_t TIFR;
+volatile uint8_t TIMSK;
+volatile uint8_t WDTCR;
+
+uint32_t host_time_us = 0;
+uint32_t host_sleep_us = 0;
+static uint32_t host_wdt_us = 0;
+uint32_t host_sleeps = 0;
+uint32_t host_sleeps_short = 0;
+uint32_t host_pinb_reads = 0;
+uint16_t host_vcc_mv = 4000;
+
+uint8_t host_eeprom [HOST_EEPROM_SIZE] = { [0 ... HOST_EEPROM_SIZE - 1] = 0xff };
+
+uint8_t host_pixels [6];
+uint32_t host_led_time_us = 0;
+uint32_t host_led_shows = 0;
+
+/*
+ * An idle sensor with a fixed fall time.
+ */
+static uint16_t host_boop_idle (void)
+{
+    return 100;
+}
+
+uint16_t (*host_boop_model) (void) = host_boop_idle;
+
+/*
+ * The boop sense pin reads high for the modelled number of loops, then low.
+ */
+uint8_t host_pinb (void)
+{
+    static int32_t remaining = -1;
+
+    host_pinb_reads++;
+
+    if (remaining < 0)
+    {
+        remaining = host_boop_model ();
+    }
+
+    if (remaining > 0)
+    {
+        remaining--;
+        return 0x01;
+    }
+
+    remaining = -1;
+    return 0x00;
+}
+
+/*
+ * The bandgap is 1.1 V, measured against Vcc.
+ */
+uint16_t host_adc (void)
+{
+    return 1100UL * 1024 / host_vcc_mv;
+}
+
+void eeprom_read_block (void *dst, const void *src, size_t n)
+{
+    memcpy (dst, &host_eeprom [(uintptr_t) src], n);
+}
+
+/*
+ * Restart the watchdog count.
+ */
+void host_wdt_reset (void)
+{
+    host_wdt_us = host_time_us;
+}
+
+/*
+ * Power down until the watchdog fires, 16 ms doubled per WDTO_ step. The
+ * count runs on from the last wdt_reset () while awake, so a sleep without
+ * one may be cut short.
+ */
+void host_sleep (void)
+{
+    uint32_t period_us = 16000UL << (WDTCR & 0x07);
+    uint32_t early_us = (host_time_us - host_wdt_us) % period_us;
+
+    if (early_us != 0)
+    {
+        period_us -= early_us;
+        host_sleeps_short++;
+    }
+
+    host_time_us += period_us;
+    host_sleep_us += period_us;
+    host_sleeps++;
+}
+
+/*
+ * Capture the pixels instead of bit-banging them.
+ */
+void led_show (uint8_t *data)
+{
+    memcpy (host_pixels, data, sizeof (host_pixels));
+    host_led_time_us = host_time_us;
+    host_led_shows++;
+}
+
+/*
+ * Capture the pixels, scaled the same way as the real transmit loop.
+ */
+void led_show_scaled (uint8_t *data, uint8_t brightness)
+{
+    for (int i = 0; i < 6; i++)
+    {
+        host_pixels [i] = ((uint16_t) data [i] * (brightness + 1)) >> 8;
+    }
+    host_led_time_us = host_time_us;
+    host_led_shows++;
+}
+
+void eeprom_update_word (uint16_t *dst, uint16_t value)
+{
+    memcpy (&host_eeprom [(uintptr_t) dst], &value, sizeof (value));
+}
@@ -0,0 +1,32 @@
+/*
+ * Simulated hardware for running the badge firmware on a PC.
+ */
+
+#include <stdint.h>
+
+/* Simulated time, advanced by the tools and by _delay_ms () */
+extern uint32_t host_time_us;
+
+/* Time and number of times powered down, and sensor pin reads (one per loop of boop_measure) */
+extern uint32_t host_sleep_us;
+extern uint32_t host_sleeps;
+extern uint32_t host_pinb_reads;
+
+/* Times the watchdog woke before its full period, having not been reset first */
+extern uint32_t host_sleeps_short;
+
+/* Supply voltage, as seen by the ADC */
+extern uint16_t host_vcc_mv;
+
+/* Boop sensor model, returns the falling-edge time in loops */
+extern uint16_t (*host_boop_model) (void);
+
+/* The most recent led_show () */
+extern uint8_t host_pixels [6];
+extern uint32_t host_led_time_us;
+extern uint32_t host_led_shows;
+
+uint8_t host_pinb (void);
+uint16_t host_adc (void);
+void host_wdt_reset (void);
+void host_sleep (void);
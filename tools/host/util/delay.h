@@ -0,0 +1,10 @@
+/*
+ * Host stand-in for <util/delay.h>. Delays advance the simulated clock.
+ */
+
+#include <stdint.h>
+
+extern uint32_t host_time_us;
+
+#define _delay_ms(ms) (host_time_us += (uint32_t) ((ms) * 1000))
+#define _delay_us(us) (host_time_us += (uint32_t) (us))
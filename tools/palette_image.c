@@ -0,0 +1,122 @@
+/*
+ * Furbadge palette image generator
+ *
+ * Writes an Intel HEX EEPROM image of the mode parameters to stdout,
+ * starting from the firmware's defaults and applying any lines from a
+ * palette file (see palette.txt for the format). Program the image with
+ * "./build.sh palette palette.hex", without reflashing the firmware.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <avr/pgmspace.h>
+
+#include "palette.h"
+
+/*
+ * Apply a palette file on top of the defaults.
+ */
+static int palette_read (const char *path, Palette_t *params)
+{
+    FILE *file = fopen (path, "r");
+    char line [256];
+    int line_number = 0;
+
+    if (file == NULL)
+    {
+        perror (path);
+        return -1;
+    }
+
+    while (fgets (line, sizeof (line), file) != NULL)
+    {
+        int mode, hue, swing, val, period, boop_hue, boop_sound;
+        char *start = line;
+
+        line_number++;
+
+        while (*start == ' ' || *start == '\t')
+        {
+            start++;
+        }
+        if (*start == '#' || *start == '\n' || *start == '\0')
+        {
+            continue;
+        }
+
+        if (sscanf (start, "%i %i %i %i %i %i %i", &mode, &hue, &swing, &val, &period, &boop_hue, &boop_sound) != 7 ||
+            mode < 0 || mode >= MODE_COUNT ||
+            hue < 0 || hue > 0xff || swing < 0 || swing > 0xff || val < 0 || val > PALETTE_VAL_MAX ||
+            period < PALETTE_PERIOD_MIN || period > PALETTE_PERIOD_MAX || boop_hue < 0 || boop_hue > 0xff ||
+            (boop_sound != BOOP_SOUND_TURNS && (boop_sound < 0 || boop_sound >= BOOP_SOUND_COUNT)))
+        {
+            fprintf (stderr, "%s:%d: Expected: mode hue swing val period boop_hue boop_sound\n", path, line_number);
+            fclose (file);
+            return -1;
+        }
+
+        params [mode].hue = hue;
+        params [mode].swing = swing;
+        params [mode].val = val;
+        params [mode].period = period;
+        params [mode].boop_hue = boop_hue;
+        params [mode].boop_sound = boop_sound;
+    }
+
+    fclose (file);
+    return 0;
+}
+
+/*
+ * Write one Intel HEX data record.
+ */
+static void hex_record (uint16_t address, const uint8_t *data, uint8_t length)
+{
+    uint8_t sum = length + (address >> 8) + (address & 0xff);
+
+    printf (":%02X%04X00", length, address);
+    for (uint8_t i = 0; i < length; i++)
+    {
+        printf ("%02X", data [i]);
+        sum += data [i];
+    }
+    printf ("%02X\n", (uint8_t) -sum);
+}
+
+int main (int argc, char **argv)
+{
+    struct {
+        PaletteHeader_t header;
+        Palette_t params [MODE_COUNT];
+    } __attribute__ ((packed)) image;
+    const uint8_t *bytes = (const uint8_t *) &image;
+
+    if (argc > 2)
+    {
+        fprintf (stderr, "Usage: %s [palette.txt] > palette.hex\n", argv [0]);
+        return EXIT_FAILURE;
+    }
+
+    memcpy_P (image.params, palette_defaults, sizeof (image.params));
+
+    if (argc == 2 && palette_read (argv [1], image.params) < 0)
+    {
+        return EXIT_FAILURE;
+    }
+
+    image.header.magic = PALETTE_MAGIC;
+    image.header.version = PALETTE_VERSION;
+    image.header.modes = MODE_COUNT;
+    image.header.checksum = palette_checksum (image.params);
+
+    for (uint16_t offset = 0; offset < sizeof (image); offset += 16)
+    {
+        uint8_t length = (sizeof (image) - offset < 16) ? sizeof (image) - offset : 16;
+
+        hex_record (PALETTE_EEPROM_ADDRESS + offset, bytes + offset, length);
+    }
+    printf (":00000001FF\n");
+
+    return EXIT_SUCCESS;
+}
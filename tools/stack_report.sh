@@ -0,0 +1,175 @@
+#!/bin/sh
+
+# Static stack depth report for the Furbadge firmware.
+#
+# Compiles the firmware with -fcallgraph-info=su and walks the call graph,
+# printing the deepest call path from main () and from each interrupt. As
+# interrupts do not nest, the worst case is main's deepest path with the
+# deepest interrupt on top of it. Exits with an error if that is more than
+# the RAM left over once .data, .bss and .noinit are placed, as reported by
+# avr-size, or than STACK_LIMIT bytes if that is set. Needs GCC 10 or newer.
+#
+# The stack usage figures already include each function's return address
+# (avr-gcc adds INCOMING_FRAME_SP_OFFSET to them), and an interrupt's
+# includes the registers it saves.
+#
+# Usage: ./build.sh stackcheck, or tools/stack_report.sh
+#
+# CC, CFLAGS, SIZE and SOURCES can be overridden, for example to try the
+# report with the host compiler:
+#   CC=gcc CFLAGS="-Os -Itools/host -I." SIZE=size STACK_LIMIT=512 SOURCES="badge.c boop.c ..." tools/stack_report.sh
+
+cd "$(dirname "$0")/.." || exit
+
+MCU="${MCU:-attiny45}"
+CC="${CC:-avr-gcc}"
+CFLAGS="${CFLAGS:--Os -DF_CPU=8000000UL -mcall-prologues -mmcu=${MCU}}"
+SIZE="${SIZE:-avr-size}"
+SOURCES="${SOURCES:-$(echo *.c)}"
+
+WORK="$(mktemp -d)" || exit
+trap 'rm -rf "${WORK}"' EXIT
+
+if ! ${CC} -fcallgraph-info=su -c -x c /dev/null -o "${WORK}/probe.o" -dumpdir "${WORK}/" 2> /dev/null
+then
+    echo "${CC} does not support -fcallgraph-info (needs GCC 10 or newer), no stack report"
+    exit 1
+fi
+
+for SOURCE in ${SOURCES}
+do
+    ${CC} ${CFLAGS} -fcallgraph-info=su -c "${SOURCE}" \
+        -o "${WORK}/$(basename "${SOURCE}" .c).o" -dumpdir "${WORK}/" || exit
+done
+rm -f "${WORK}/probe.o" "${WORK}/probe.ci"
+
+# The stack gets whatever RAM the variables leave
+if [ -z "${STACK_LIMIT}" ]
+then
+    ${CC} ${CFLAGS} "${WORK}"/*.o -o "${WORK}/badge.elf" || exit
+    RAM="$(printf '#include <avr/io.h>\nRAMEND - RAMSTART + 1\n' | ${CC} ${CFLAGS} -E -P -x c - | tail -n 1)"
+    RAM="$((${RAM}))" || exit
+    STATIC="$(${SIZE} -A "${WORK}/badge.elf" | awk '$1 == ".data" || $1 == ".bss" || $1 == ".noinit" { sum += $2 } END { print sum + 0 }')"
+    STACK_LIMIT="$((RAM - STATIC))"
+    echo "RAM: ${RAM} bytes, ${STATIC} in .data, .bss and .noinit, ${STACK_LIMIT} left for the stack"
+fi
+
+awk -v limit="${STACK_LIMIT}" '
+
+# node: { title: "name" label: "name\nfile:line:col\nN bytes (static)" }
+/^node:/ {
+    name = $0
+    sub (/^node: \{ title: "/, "", name)
+    sub (/".*/, "", name)
+
+    if (match ($0, /[0-9]+ bytes \([a-z,]+\)/))
+    {
+        split (substr ($0, RSTART, RLENGTH), usage, " ")
+        frame [name] = usage [1]
+        if (usage [3] != "(static)")
+        {
+            dynamic [name] = usage [3]
+        }
+    }
+    next
+}
+
+# edge: { sourcename: "caller" targetname: "callee" label: "file:line:col" }
+/^edge:/ {
+    split ($0, field, "\"")
+    if (!((field [2], field [4]) in seen))
+    {
+        seen [field [2], field [4]] = 1
+        callees [field [2]] = callees [field [2]] " " field [4]
+    }
+    next
+}
+
+# Deepest stack use from entering name ().
+function depth (name,    list, n, i, d, best)
+{
+    if (name in memo)
+    {
+        return memo [name]
+    }
+    if (name in active)
+    {
+        recursive [name] = 1
+        return 0
+    }
+    if (!(name in frame))
+    {
+        unknown [name] = 1
+    }
+
+    active [name] = 1
+    best = 0
+    deepest [name] = ""
+    n = split (callees [name], list, " ")
+    for (i = 1; i <= n; i++)
+    {
+        d = depth (list [i])
+        if (d > best)
+        {
+            best = d
+            deepest [name] = list [i]
+        }
+    }
+    delete active [name]
+
+    memo [name] = frame [name] + best
+    return memo [name]
+}
+
+function path (name,    p)
+{
+    p = name
+    while (deepest [name] != "")
+    {
+        name = deepest [name]
+        p = p " -> " name
+    }
+    return p
+}
+
+END {
+    main_depth = depth ("main")
+    printf "%5d  %s\n", main_depth, path ("main")
+
+    isr_depth = 0
+    for (name in frame)
+    {
+        if (name ~ /^__vector_[0-9]+$/ || name ~ /_vect$/)
+        {
+            d = depth (name)
+            printf "%5d  %s\n", d, path (name)
+            if (d > isr_depth)
+            {
+                isr_depth = d
+            }
+        }
+    }
+
+    for (name in unknown)
+    {
+        printf "Warning: no stack usage for %s (not compiled here), counted as 0 bytes\n", name
+    }
+    for (name in dynamic)
+    {
+        printf "Warning: %s has a %s frame\n", name, dynamic [name]
+    }
+    for (name in recursive)
+    {
+        printf "Warning: %s is recursive, depth is not bounded\n", name
+    }
+
+    total = main_depth + isr_depth
+    printf "Worst case: %d bytes (main %d + interrupt %d), limit %d\n", total, main_depth, isr_depth, limit
+
+    if (total > limit)
+    {
+        print "Stack limit exceeded"
+        exit 1
+    }
+}
+' "${WORK}"/*.ci
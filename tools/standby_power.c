@@ -0,0 +1,101 @@
+/*
+ * Furbadge standby power harness
+ *
+ * Runs standby () against a simulated boop sensor and watchdog, and reports
+ * how often the booper is checked, how long each check keeps the CPU
+ * awake, the resulting average current, how quickly a boop wakes the
+ * badge, and whether any watchdog sleep was cut short. This is run with the booper released, and again with it held down
+ * on entry, as by something pressing on it in a bag.
+ *
+ * Currents are ATtiny45 datasheet typicals at 3 V. Active time is counted
+ * in cycles: the fixed cost of waking and re-arming the watchdog, plus one
+ * boop_measure () loop per read of the sensor pin.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#define main badge_main
+#include "badge.c"
+#undef main
+
+#include "host.h"
+
+#define STANDBY_S           600     /* Time in standby before the boop */
+#define HELD_S              1800    /* Time held down, as if pressed on in a bag */
+
+#define CPU_HZ              8000000
+#define WAKE_CYCLES         100     /* Per wake: start-up, vector, watchdog set-up */
+#define LOOP_CYCLES         6       /* Per loop of boop_measure () */
+
+#define ACTIVE_UA           3000.0  /* Active at 8 MHz */
+#define POWER_DOWN_UA       4.0     /* Power-down, watchdog running */
+
+static uint32_t held_end_us = 0;
+static uint32_t press_start_us = UINT32_MAX;
+
+static uint16_t boop_model (void)
+{
+    return (host_time_us < held_end_us || host_time_us >= press_start_us) ? 400 : 100;
+}
+
+/*
+ * Run standby () with the booper held down for its first held_s seconds,
+ * then booped well after release, and report on it.
+ */
+static bool standby_run (const char *name, uint32_t held_s)
+{
+    uint32_t start_us;
+    uint32_t elapsed_us;
+    uint32_t checks;
+    uint32_t active_cycles;
+    double active_us;
+    double average_ua;
+
+    start_us = host_time_us;
+    held_end_us = start_us + held_s * 1000000UL;
+    press_start_us = held_end_us + STANDBY_S * 1000000UL + 123457;
+    host_sleep_us = 0;
+    host_sleeps = 0;
+    host_sleeps_short = 0;
+    host_pinb_reads = 0;
+
+    standby ();
+
+    /* Awake while not asleep, such as in boop_sense ()'s delay, plus the counted cycles */
+    elapsed_us = host_time_us - start_us;
+    checks = host_sleeps / 2;
+    active_cycles = host_sleeps * WAKE_CYCLES + host_pinb_reads * LOOP_CYCLES;
+    active_us = (elapsed_us - host_sleep_us) + active_cycles * 1000000.0 / CPU_HZ;
+    average_ua = (active_us * ACTIVE_UA + host_sleep_us * POWER_DOWN_UA) / elapsed_us;
+
+    printf ("%s:\n", name);
+    printf ("  Standby checks: %.2f per second, %.0f us awake per check\n",
+            checks * 1000000.0 / elapsed_us, active_us / checks);
+    printf ("  Standby current: %.1f uA average (%.3f%% awake)\n",
+            average_ua, active_us * 100.0 / elapsed_us);
+    printf ("  Wake latency: %.0f ms from boop to resume\n",
+            (host_time_us - press_start_us) / 1000.0);
+    printf ("  Watchdog sleeps cut short: %u\n", host_sleeps_short);
+
+    /* Resumed, with the waking boop ended */
+    held_end_us = 0;
+    press_start_us = UINT32_MAX;
+
+    /* Every wake check must charge the booper for the same time */
+    return (TIMSK & 0x10) != 0 && host_sleeps_short == 0;
+}
+
+int main (void)
+{
+    bool resumed;
+
+    host_boop_model = boop_model;
+    palette_load ();
+    boop_calibrate ();
+
+    resumed = standby_run ("Released", 0);
+    resumed &= standby_run ("Held down for the first half hour", HELD_S);
+
+    return resumed ? 0 : 1;
+}
@@ -0,0 +1,440 @@
+/*
+ * Furbadge WS2812 timing check
+ *
+ * Reads the inline assembly of led_show () and led_show_scaled () from
+ * led_bitbang.c and runs it on a cycle-counting model of the few AVR
+ * instructions it uses. The waveform on the LED pin is then decoded as a
+ * WS2812 would, checking the pulse widths against the limits below and the
+ * decoded bytes against the pixels (scaled, for led_show_scaled ()).
+ *
+ * Cycle counts are those of the ATtiny25/45/85 instruction set summary.
+ * This checks the source, not an assembled listing.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CPU_MHZ         8
+
+/* Pulse limits in ns, from measurements of real WS2812s rather than the datasheet */
+#define HIGH_0_MIN      200
+#define HIGH_0_MAX      500
+#define HIGH_1_MIN      625
+#define LOW_MAX         5000    /* Longer risks being taken as a latch */
+
+#define LED_PIN         0x04    /* PB2 */
+#define PIXEL_BYTES     6
+
+#define MAX_LINES       128
+
+typedef struct Line_s {
+    char label [32];
+    char op [8];
+    char a [32];
+    char b [32];
+} Line_t;
+
+typedef struct Block_s {
+    Line_t lines [MAX_LINES];
+    int count;
+} Block_t;
+
+/* Machine state */
+typedef struct Cpu_s {
+    uint8_t byte, next, acc, n1, n2, hi, lo, bright;
+    uint16_t count;
+    const uint8_t *ptr;
+    bool carry;
+    bool zero;
+    uint32_t cycle;
+    uint8_t pin;
+} Cpu_t;
+
+/* Decoded output */
+static uint8_t decoded [PIXEL_BYTES];
+static int decoded_bits;
+static uint32_t pin_edge;
+static uint32_t worst_high_0 [2] = { UINT32_MAX, 0 };
+static uint32_t worst_high_1 [2] = { UINT32_MAX, 0 };
+static uint32_t worst_low = 0;
+
+/*
+ * Copy the asm string from one source line, without the trailing "\n\t".
+ */
+static bool asm_text (const char *source, char *text)
+{
+    const char *start = strchr (source, '"');
+    const char *end;
+
+    if (start == NULL || (end = strstr (start + 1, "\\n")) == NULL)
+    {
+        return false;
+    }
+
+    memcpy (text, start + 1, end - start - 1);
+    text [end - start - 1] = '\0';
+    return true;
+}
+
+static void trim (char *s)
+{
+    char *start = s;
+    size_t length;
+
+    while (*start == ' ')
+    {
+        start++;
+    }
+    memmove (s, start, strlen (start) + 1);
+
+    length = strlen (s);
+    while (length && s [length - 1] == ' ')
+    {
+        s [--length] = '\0';
+    }
+}
+
+/*
+ * Read the asm blocks of led_bitbang.c, in order.
+ */
+static int read_blocks (const char *path, Block_t *blocks, int max)
+{
+    FILE *file = fopen (path, "r");
+    char source [256];
+    char text [128];
+    int count = 0;
+    bool inside = false;
+
+    if (file == NULL)
+    {
+        perror (path);
+        exit (1);
+    }
+
+    while (fgets (source, sizeof (source), file))
+    {
+        if (strstr (source, "asm volatile ("))
+        {
+            if (count == max)
+            {
+                break;
+            }
+            inside = true;
+            blocks [count].count = 0;
+            continue;
+        }
+
+        if (!inside)
+        {
+            continue;
+        }
+
+        if (!asm_text (source, text))
+        {
+            /* The operand lists follow the last instruction */
+            inside = false;
+            count++;
+            continue;
+        }
+
+        Line_t *line = &blocks [count].lines [blocks [count].count++];
+        char *colon = strchr (text, ':');
+        char *comma;
+
+        memset (line, 0, sizeof (*line));
+        trim (text);
+
+        if (colon != NULL)
+        {
+            *colon = '\0';
+            snprintf (line->label, sizeof (line->label), "%s", text);
+            continue;
+        }
+
+        sscanf (text, "%7s", line->op);
+        memmove (text, text + strlen (line->op), strlen (text) - strlen (line->op) + 1);
+        if ((comma = strchr (text, ',')) != NULL)
+        {
+            *comma = '\0';
+            snprintf (line->b, sizeof (line->b), "%s", comma + 1);
+            trim (line->b);
+        }
+        snprintf (line->a, sizeof (line->a), "%s", text);
+        trim (line->a);
+    }
+
+    fclose (file);
+    return count;
+}
+
+/*
+ * Resolve a "%[name]" operand to an 8-bit register.
+ */
+static uint8_t *reg (Cpu_t *cpu, const char *operand)
+{
+    static const char *names [] = { "byte", "next", "acc", "n1", "n2", "hi", "lo", "bright" };
+    uint8_t *regs [] = { &cpu->byte, &cpu->next, &cpu->acc, &cpu->n1, &cpu->n2, &cpu->hi, &cpu->lo, &cpu->bright };
+
+    for (int i = 0; i < 8; i++)
+    {
+        if (strncmp (operand + 2, names [i], strlen (names [i])) == 0 && operand [2 + strlen (names [i])] == ']')
+        {
+            return regs [i];
+        }
+    }
+
+    fprintf (stderr, "Unknown register %s\n", operand);
+    exit (1);
+}
+
+/*
+ * Follow the LED pin as a WS2812 would: a rising edge starts a bit, whose
+ * value is set by how long it stays high.
+ */
+static void pin_write (Cpu_t *cpu, uint8_t value)
+{
+    uint8_t pin = value & LED_PIN;
+    uint32_t length = cpu->cycle - pin_edge;
+
+    if (pin == cpu->pin)
+    {
+        return;
+    }
+
+    if (pin)
+    {
+        /* End of a low time, ignoring the idle time before the first bit */
+        if (decoded_bits > 0 && length > worst_low)
+        {
+            worst_low = length;
+        }
+    }
+    else
+    {
+        bool one = length * 1000 / CPU_MHZ >= HIGH_1_MIN;
+        uint32_t *worst = one ? worst_high_1 : worst_high_0;
+
+        worst [0] = (length < worst [0]) ? length : worst [0];
+        worst [1] = (length > worst [1]) ? length : worst [1];
+
+        if (decoded_bits < PIXEL_BYTES * 8)
+        {
+            decoded [decoded_bits / 8] = (decoded [decoded_bits / 8] << 1) | one;
+        }
+        decoded_bits++;
+    }
+
+    cpu->pin = pin;
+    pin_edge = cpu->cycle;
+}
+
+static int find_label (const Block_t *block, const char *label)
+{
+    for (int i = 0; i < block->count; i++)
+    {
+        if (strcmp (block->lines [i].label, label) == 0)
+        {
+            return i;
+        }
+    }
+
+    fprintf (stderr, "Unknown label %s\n", label);
+    exit (1);
+}
+
+/*
+ * Run one asm block until it falls out of the bottom.
+ */
+static void run (const Block_t *block, Cpu_t *cpu)
+{
+    int pc = 0;
+
+    while (pc < block->count)
+    {
+        const Line_t *line = &block->lines [pc++];
+        uint16_t sum;
+
+        if (line->label [0])
+        {
+            continue;
+        }
+
+        if (strcmp (line->op, "out") == 0)
+        {
+            cpu->cycle += 1;
+            pin_write (cpu, *reg (cpu, line->b));
+        }
+        else if (strcmp (line->op, "mov") == 0)
+        {
+            *reg (cpu, line->a) = *reg (cpu, line->b);
+            cpu->cycle += 1;
+        }
+        else if (strcmp (line->op, "clc") == 0)
+        {
+            cpu->carry = false;
+            cpu->cycle += 1;
+        }
+        else if (strcmp (line->op, "add") == 0)
+        {
+            sum = *reg (cpu, line->a) + *reg (cpu, line->b);
+            *reg (cpu, line->a) = sum;
+            cpu->carry = sum > 0xff;
+            cpu->cycle += 1;
+        }
+        else if (strcmp (line->op, "ror") == 0)
+        {
+            uint8_t *r = reg (cpu, line->a);
+            bool out = *r & 0x01;
+
+            *r = (*r >> 1) | (cpu->carry ? 0x80 : 0x00);
+            cpu->carry = out;
+            cpu->cycle += 1;
+        }
+        else if (strcmp (line->op, "sbrc") == 0)
+        {
+            /* Skipping a one-word instruction takes two cycles */
+            cpu->cycle += 1;
+            if (!(*reg (cpu, line->a) & (1 << atoi (line->b))))
+            {
+                pc++;
+                cpu->cycle += 1;
+            }
+        }
+        else if (strcmp (line->op, "ld") == 0)
+        {
+            *reg (cpu, line->a) = *cpu->ptr++;
+            cpu->cycle += 2;
+        }
+        else if (strcmp (line->op, "sbiw") == 0)
+        {
+            cpu->count -= atoi (line->b);
+            cpu->zero = cpu->count == 0;
+            cpu->cycle += 2;
+        }
+        else if (strcmp (line->op, "brne") == 0)
+        {
+            cpu->cycle += 1;
+            if (!cpu->zero)
+            {
+                pc = find_label (block, line->a);
+                cpu->cycle += 1;
+            }
+        }
+        else if (strcmp (line->op, "rjmp") == 0 && strcmp (line->a, ".+0") == 0)
+        {
+            cpu->cycle += 2;
+        }
+        else
+        {
+            fprintf (stderr, "Unknown instruction %s\n", line->op);
+            exit (1);
+        }
+    }
+}
+
+/*
+ * Send the pixels with one of the loops, set up as its C prologue does,
+ * and compare what a WS2812 would receive with what was expected.
+ */
+static bool send (const Block_t *block, bool scaled, const uint8_t *pixels, uint8_t brightness)
+{
+    uint8_t data [PIXEL_BYTES + 2] = { 0 };
+    uint8_t expected [PIXEL_BYTES];
+    Cpu_t cpu = { .hi = LED_PIN, .lo = 0x00, .bright = brightness, .count = PIXEL_BYTES };
+
+    memcpy (data, pixels, PIXEL_BYTES);
+    for (int i = 0; i < PIXEL_BYTES; i++)
+    {
+        expected [i] = scaled ? ((uint16_t) pixels [i] * (brightness + 1)) >> 8 : pixels [i];
+    }
+
+    cpu.ptr = data;
+    cpu.byte = scaled ? expected [0] : *cpu.ptr;
+    cpu.ptr++;
+    if (scaled)
+    {
+        cpu.next = *cpu.ptr++;
+    }
+    cpu.n1 = (cpu.byte & 0x80) ? cpu.hi : cpu.lo;
+
+    memset (decoded, 0, sizeof (decoded));
+    decoded_bits = 0;
+    pin_edge = 0;
+
+    run (block, &cpu);
+
+    return decoded_bits == PIXEL_BYTES * 8 && memcmp (decoded, expected, PIXEL_BYTES) == 0;
+}
+
+static void reset_worst (void)
+{
+    worst_high_0 [0] = worst_high_1 [0] = UINT32_MAX;
+    worst_high_0 [1] = worst_high_1 [1] = 0;
+    worst_low = 0;
+}
+
+/*
+ * Print the worst pulses seen, returning false if any are out of limits.
+ */
+static bool report (const char *name, uint32_t frames, uint32_t bad)
+{
+    bool pass = bad == 0 &&
+                worst_high_0 [0] * 1000 / CPU_MHZ >= HIGH_0_MIN && worst_high_0 [1] * 1000 / CPU_MHZ <= HIGH_0_MAX &&
+                worst_high_1 [0] * 1000 / CPU_MHZ >= HIGH_1_MIN && worst_low * 1000 / CPU_MHZ <= LOW_MAX;
+
+    printf ("%s: high 0 %u-%u ns, high 1 %u-%u ns, longest low %u ns (%u clocks), %u of %u frames wrong: %s\n",
+            name,
+            worst_high_0 [0] * 1000 / CPU_MHZ, worst_high_0 [1] * 1000 / CPU_MHZ,
+            worst_high_1 [0] * 1000 / CPU_MHZ, worst_high_1 [1] * 1000 / CPU_MHZ,
+            worst_low * 1000 / CPU_MHZ, worst_low, bad, frames, pass ? "pass" : "FAIL");
+
+    return pass;
+}
+
+int main (int argc, char **argv)
+{
+    Block_t *blocks = calloc (2, sizeof (Block_t));
+    uint8_t pixels [PIXEL_BYTES];
+    uint32_t frames = 0;
+    uint32_t bad = 0;
+    bool pass = true;
+
+    if (read_blocks ((argc > 1) ? argv [1] : "led_bitbang.c", blocks, 2) != 2)
+    {
+        fprintf (stderr, "Expected two asm blocks\n");
+        return 1;
+    }
+
+    srand (1);
+
+    for (frames = 0; frames < 10000; frames++)
+    {
+        for (int i = 0; i < PIXEL_BYTES; i++)
+        {
+            pixels [i] = (frames < 256) ? (uint8_t) frames : (uint8_t) rand ();
+        }
+        bad += !send (&blocks [0], false, pixels, 0xff);
+    }
+    pass &= report ("led_show", frames, bad);
+
+    reset_worst ();
+    frames = 0;
+    bad = 0;
+    for (int brightness = 0; brightness < 256; brightness++)
+    {
+        for (int i = 0; i < 256; i++, frames++)
+        {
+            for (int j = 0; j < PIXEL_BYTES; j++)
+            {
+                pixels [j] = (j & 1) ? i : rand ();
+            }
+            bad += !send (&blocks [1], true, pixels, brightness);
+        }
+    }
+    pass &= report ("led_show_scaled", frames, bad);
+
+    return pass ? 0 : 1;
+}